@@ -1,71 +1,30 @@
 #pragma once
 
-#include <cstdint>
-#include <functional>
-#include <unordered_map>
+#include <cstddef>
+#include <utility>
 
 #include "raylib.h"
 
+#include "callback_list.hpp"
+
 /*
  * Abstraction over InputManager, allows regestering multiple callbacks to a
  * single keyboard key, as well as regestering the same group of callbacks to
  * multiple keyboard keys
  */
 
-template<typename T>
-using callback_map_t = std::unordered_map<uint32_t, T>;
-
-// The CallbackHandle class automatically disassociates the associated callback
-// from the action when it is destroyed, allowing callback deregistration to be
-// handled via RAII rather than done manually (requiring manual destructor
-// definitions, and it could easily be missed causing SEGFAULTS when closures
-// try to refer to deallocated memory)
-template<typename T>
-class CallbackHandle {
-	callback_map_t<T> *map;
-	uint32_t id;
-public:
-	CallbackHandle() : map(nullptr), id(0) { }
-	CallbackHandle(callback_map_t<T> &map, uint32_t id) : map(&map), id(id) { }
-	~CallbackHandle() {
-		// simply detach upon destruction
-		detach();
-	}
-
-	CallbackHandle(const CallbackHandle&) = delete;
-	CallbackHandle &operator=(const CallbackHandle&) = delete;
-
-	CallbackHandle(CallbackHandle &&other) noexcept : map(other.map), id(other.id) {
-		other.map = nullptr;
-	}
-	CallbackHandle &operator=(CallbackHandle &&other) noexcept {
-		if (&other != this) {
-			detach();
-			id = other.id;
-			map = other.map;
-			other.map = nullptr;
-		}
-		return *this;
-	}
-
-	void detach() {
-		// to detach, erase the callback from the callback map using
-		// its ID
-		if (map) map->erase(id);
-		map = nullptr;
-		id = 0;
-	}
-};
+// the most callbacks that can be registered to a single action at once
+constexpr size_t ACTION_CAPACITY = 8;
 
 // an action which is called only when a key is pressed or released
 class ActionOnce {
 public:
-	using cb_t = std::function<void()>;
-	using cb_handle_t = CallbackHandle<cb_t>;
+	using cb_t = InlineFunction<void()>;
+	using cb_list_t = CallbackList<cb_t, ACTION_CAPACITY>;
+	using cb_handle_t = cb_list_t::handle_t;
 
 private:
-	callback_map_t<cb_t> callbacks;
-	uint32_t id_counter = 0;
+	cb_list_t callbacks;
 public:
 	ActionOnce();
 	void register_key(KeyboardKey key, bool on_press) const;
@@ -77,20 +36,22 @@ public:
 // an action which calls one callback on key press and another on key release
 class ActionStartStop {
 public:
-	using cb_t = std::function<void()>;
+	using cb_t = InlineFunction<void()>;
 	using dbl_cb_t = std::pair<cb_t, cb_t>;
-	using cb_handle_t = CallbackHandle<dbl_cb_t>;
+	using cb_list_t = CallbackList<dbl_cb_t, ACTION_CAPACITY>;
+	using cb_handle_t = cb_list_t::handle_t;
 
 private:
-	callback_map_t<dbl_cb_t> callbacks;
-	uint32_t id_counter = 0;
-	bool active = false;
+	cb_list_t callbacks;
+	// how many of the action's keys are held down, so that holding down
+	// several of them only starts and stops the action once
+	int keys_down = 0;
 public:
 	ActionStartStop();
 	void register_key(KeyboardKey key);
 	cb_handle_t register_cb(cb_t on_start, cb_t on_end);
 
-	bool is_active() const { return active; }
+	bool is_active() const { return keys_down > 0; }
 
 	void press();
 	void release();
@@ -99,12 +60,12 @@ public:
 // an action which is called every frame that the key is held
 class ActionSustain {
 public:
-	using cb_t = std::function<void(float)>;
-	using cb_handle_t = CallbackHandle<cb_t>;
+	using cb_t = InlineFunction<void(float)>;
+	using cb_list_t = CallbackList<cb_t, ACTION_CAPACITY>;
+	using cb_handle_t = cb_list_t::handle_t;
 
 private:
-	callback_map_t<cb_t> callbacks;
-	uint32_t id_counter = 0;
+	cb_list_t callbacks;
 public:
 	ActionSustain();
 	void register_key(KeyboardKey key) const;
@@ -117,19 +78,23 @@ namespace Action {
 
 // here comes the list of actions the program is aware of
 
-extern ActionSustain Jump;
+extern ActionStartStop Jump;
 extern ActionOnce DoubleJump;
-extern ActionSustain Slam;
-extern ActionSustain Left;
-extern ActionSustain Right;
+extern ActionStartStop Slam;
+extern ActionStartStop Left;
+extern ActionStartStop Right;
 #ifdef DEBUG
-extern ActionSustain Fly;
+extern ActionStartStop Fly;
+extern ActionOnce ExportTrace;
+extern ActionOnce SlowDown;
+extern ActionOnce SpeedUp;
 #endif
 
 extern ActionOnce Suicide;
 extern ActionOnce Reset;
 extern ActionOnce Pause;
 extern ActionOnce NextLevel;
+extern ActionOnce TogglePerfHud;
 
 // here comes the key associations for the actions
 
@@ -146,18 +111,18 @@ static const struct {
 	{ KEY_ESCAPE, Pause, true },
 	{ KEY_ENTER, NextLevel, true },
 	{ KEY_SPACE, NextLevel, true },
+	{ KEY_F2, TogglePerfHud, true },
+	#ifdef DEBUG
+	{ KEY_F3, ExportTrace, true },
+	{ KEY_LEFT_BRACKET, SlowDown, true },
+	{ KEY_RIGHT_BRACKET, SpeedUp, true },
+	#endif
 };
 
 static const struct {
 	KeyboardKey key;
 	ActionStartStop &action;
 } INIT_KEYMAP_STARTSTOP[] = {
-};
-
-static const struct {
-	KeyboardKey key;
-	ActionSustain &action;
-} INIT_KEYMAP_SUSTAIN[] = {
 	{ KEY_A, Left },
 	{ KEY_LEFT, Left },
 	{ KEY_H, Left },
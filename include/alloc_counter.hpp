@@ -0,0 +1,23 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+
+/*
+ * counts the heap allocations made through the global operator new, which
+ * src/alloc_counter.cpp replaces for the game and the tools alike
+ *
+ * Note that only operator new is counted: memory raylib (or any other C code)
+ * gets straight from malloc doesn't show up here.
+ */
+
+namespace alloc_counter {
+
+extern std::atomic<uint64_t> allocations;
+
+// the number of allocations made so far, by any thread
+inline uint64_t count() {
+	return allocations.load(std::memory_order_relaxed);
+}
+
+}
@@ -0,0 +1,176 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <iostream>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+/*
+ * Allocation-free callback storage: a function wrapper that keeps small
+ * callables inline, and a fixed-capacity list of callbacks with RAII handles
+ */
+
+// Like std::function, but the callable is always stored inside the object
+// itself, so it never allocates. This limits it to small callables which can
+// be copied and destroyed trivially, like lambdas capturing this and a pointer
+// or two, which is what the game's callbacks are.
+template<typename Signature, size_t Size = 2*sizeof(void*)>
+class InlineFunction;
+
+template<typename R, typename... Args, size_t Size>
+class InlineFunction<R(Args...), Size> {
+	alignas(void*) unsigned char storage[Size] = {};
+	R (*invoker)(const unsigned char *storage, Args... args) = nullptr;
+
+public:
+	InlineFunction() = default;
+
+	template<
+		typename F,
+		typename = std::enable_if_t<!std::is_same_v<std::decay_t<F>, InlineFunction>>
+	>
+	InlineFunction(F f) {
+		static_assert(sizeof(F) <= Size, "the callable doesn't fit in the InlineFunction");
+		static_assert(alignof(F) <= alignof(void*), "the callable is overaligned");
+		static_assert(
+			std::is_trivially_copyable_v<F> && std::is_trivially_destructible_v<F>,
+			"the callable must be trivially copyable and destructible"
+		);
+
+		new (storage) F(f);
+		invoker = [](const unsigned char *storage, Args... args) -> R {
+			return (*std::launder(reinterpret_cast<const F *>(storage)))(
+				std::forward<Args>(args)...
+			);
+		};
+	}
+
+	explicit operator bool() const { return invoker != nullptr; }
+
+	R operator()(Args... args) const {
+		return invoker(storage, std::forward<Args>(args)...);
+	}
+};
+
+template<typename T, size_t Capacity>
+class CallbackList;
+
+// The CallbackHandle class automatically disassociates the associated callback
+// from the action when it is destroyed, allowing callback deregistration to be
+// handled via RAII rather than done manually (requiring manual destructor
+// definitions, and it could easily be missed causing SEGFAULTS when closures
+// try to refer to deallocated memory)
+//
+// A handle refers to a slot of the list along with the slot's generation,
+// which changes every time the slot is freed, so a handle whose callback has
+// been removed already can never remove another callback that reused the slot.
+template<typename List>
+class CallbackHandle {
+	List *list;
+	uint32_t slot;
+	uint32_t generation;
+public:
+	CallbackHandle() : list(nullptr), slot(0), generation(0) { }
+	CallbackHandle(List &list, uint32_t slot, uint32_t generation)
+	: list(&list), slot(slot), generation(generation) { }
+	~CallbackHandle() {
+		// simply detach upon destruction
+		detach();
+	}
+
+	CallbackHandle(const CallbackHandle&) = delete;
+	CallbackHandle &operator=(const CallbackHandle&) = delete;
+
+	CallbackHandle(CallbackHandle &&other) noexcept
+	: list(other.list), slot(other.slot), generation(other.generation) {
+		other.list = nullptr;
+	}
+	CallbackHandle &operator=(CallbackHandle &&other) noexcept {
+		if (&other != this) {
+			detach();
+			list = other.list;
+			slot = other.slot;
+			generation = other.generation;
+			other.list = nullptr;
+		}
+		return *this;
+	}
+
+	void detach() {
+		if (list) list->remove(slot, generation);
+		list = nullptr;
+	}
+};
+
+// A list of at most Capacity callbacks (or other values), stored contiguously
+// in the order they were added in, so that going over them is just going over
+// an array. Adding and removing doesn't allocate; removing shifts the later
+// callbacks down, which is cheap for the handful of callbacks an action has.
+// Callbacks may not be added or removed while going over the list.
+template<typename T, size_t Capacity>
+class CallbackList {
+public:
+	using handle_t = CallbackHandle<CallbackList>;
+
+private:
+	static constexpr uint32_t FREE = UINT32_MAX;
+
+	struct Entry {
+		T value;
+		uint32_t slot;
+	};
+	struct Slot {
+		// the entry the slot refers to, or FREE
+		uint32_t index = FREE;
+		uint32_t generation = 0;
+	};
+
+	Entry entries[Capacity] = {};
+	Slot slots[Capacity] = {};
+	uint32_t count = 0;
+
+	friend handle_t;
+	void remove(uint32_t slot, uint32_t generation) {
+		Slot &s = slots[slot];
+		if (s.generation != generation || s.index == FREE) return;
+
+		for (uint32_t i = s.index; i + 1 < count; ++i) {
+			entries[i] = entries[i + 1];
+			slots[entries[i].slot].index = i;
+		}
+		--count;
+		s.index = FREE;
+		++s.generation;
+	}
+
+public:
+	CallbackList() = default;
+	// the handles refer to the list, so it may not move
+	CallbackList(const CallbackList&) = delete;
+	CallbackList &operator=(const CallbackList&) = delete;
+
+	// returns an empty handle (and doesn't add the callback) if the list
+	// is full
+	handle_t add(T value) {
+		for (uint32_t slot = 0; slot < Capacity; ++slot) {
+			Slot &s = slots[slot];
+			if (s.index != FREE) continue;
+
+			s.index = count;
+			entries[count++] = { value, slot };
+			return { *this, slot, s.generation };
+		}
+
+		std::cerr << "ERROR: more than " << Capacity << " callbacks registered to an action, ignoring the new one!" << std::endl;
+		return {};
+	}
+
+	size_t size() const { return count; }
+
+	template<typename F>
+	void for_each(F f) const {
+		for (uint32_t i = 0; i < count; ++i) f(entries[i].value);
+	}
+};
@@ -0,0 +1,69 @@
+#pragma once
+
+#include <cstddef>
+#include <vector>
+
+#include "raylib.h"
+
+#include "tile_grid.hpp"
+
+/*
+ * caches the tiles of a level's chunks in textures, so that a chunk can be
+ * drawn with a single draw call rather than one per tile
+ */
+
+// Every chunk is baked into a CHUNK_SIZE x CHUNK_SIZE texture with one texel
+// per tile, which is drawn with point filtering so that the tiles stay sharp
+// squares. The tiles drawn in front of the player get a separate texture.
+// Baking allocates (through raylib) and uploads to the GPU, so it is kept out
+// of drawing: levels with up to MAX_BAKED_UP_FRONT non-empty chunks are baked
+// whole when the renderer is created, and larger ones are baked a few chunks
+// at a time ahead of the camera with bake_area. Since baking needs the
+// graphics context this may only be used from the main thread, and nothing is
+// baked while there is no window (eg. in the headless tools).
+class ChunkRenderer {
+public:
+	struct Layers {
+		// the id of a layer's texture is 0 if it contains no tiles
+		Texture2D back;
+		Texture2D front;
+	};
+
+	// at most 8KiB of textures per chunk, so at most 32MiB up front
+	static constexpr size_t MAX_BAKED_UP_FRONT = 4096;
+
+private:
+	struct Entry {
+		bool baked = false;
+		Layers layers = {};
+	};
+	std::vector<Entry> chunks;
+	int chunks_w = 0, chunks_h = 0;
+	// non-empty chunks which haven't been baked yet
+	size_t unbaked = 0;
+
+	void bake(const TileGrid &tiles, int cx, int cy);
+
+public:
+	ChunkRenderer() = default;
+	// bakes the whole level if it is small enough
+	explicit ChunkRenderer(const TileGrid &tiles);
+	~ChunkRenderer();
+
+	ChunkRenderer(const ChunkRenderer&) = delete;
+	ChunkRenderer &operator=(const ChunkRenderer&) = delete;
+
+	bool all_baked() const { return unbaked == 0; }
+	// bakes at most budget of the non-empty chunks not baked yet in the
+	// given (inclusive) range of chunks, which is clamped to the level;
+	// tiles must be the grid this renderer was created for. Returns the
+	// number of chunks baked.
+	size_t bake_area(const TileGrid &tiles, int cx0, int cy0, int cx1, int cy1, size_t budget);
+
+	// nullptr if the chunk hasn't been baked (yet), in which case its
+	// tiles have to be drawn one by one
+	const Layers *get(int cx, int cy) const {
+		const Entry &chunk = chunks[size_t(cx) + size_t(cy)*chunks_w];
+		return chunk.baked ? &chunk.layers : nullptr;
+	}
+};
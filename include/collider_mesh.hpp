@@ -0,0 +1,58 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "tile_grid.hpp"
+
+/*
+ * the static colliders of a level: tiles merged into maximal rectangles, with
+ * a spatial index for looking up the rectangles in a region of the level
+ */
+
+// Runs of adjacent tiles which behave the same (same type, bounce, and
+// friction) are merged into as large rectangles as possible, so that eg. a
+// tall wall is a single collider rather than one collider per tile; this
+// means fewer collision checks, and no seams between the tiles of a wall or
+// floor. Checkpoints are never merged, as each one marks a spawn position.
+//
+// The rectangles are bucketed into a coarse grid, where each bucket lists the
+// rectangles overlapping it.
+class ColliderMesh {
+public:
+	struct Collider {
+		// in level cells
+		int x, y, w, h;
+		// palette index of the collider's tiles (which all behave the same)
+		TileGrid::index_t tile;
+	};
+
+	static constexpr int BUCKET_BITS = 4; // 16x16 cells per bucket
+
+private:
+	std::vector<Collider> colliders;
+	// the colliders overlapping bucket i are listed in
+	// bucket_items[bucket_start[i] .. bucket_start[i+1]], in the order they
+	// were created
+	std::vector<uint32_t> bucket_start;
+	std::vector<uint32_t> bucket_items;
+	int w = 0, h = 0;
+	int buckets_w = 0, buckets_h = 0;
+
+public:
+	ColliderMesh() = default;
+	// with merge false, every tile gets a collider of its own, as before
+	// tiles were merged; this is only used for comparing the two (see
+	// tools/collider_diff.cpp)
+	explicit ColliderMesh(const TileGrid &tiles, bool merge = true);
+
+	// writes the colliders overlapping the given (inclusive) range of
+	// cells to out, clipped to the range and sorted by their (clipped) top
+	// left corner, row by row; returns the number of colliders written,
+	// which is never more than cap
+	size_t query(int x0, int y0, int x1, int y1, Collider *out, size_t cap) const;
+
+	size_t size() const { return colliders.size(); }
+	size_t memory_usage() const;
+};
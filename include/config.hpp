@@ -13,7 +13,13 @@ enum class WindowState { Windowed, Borderless, Fullscreen };
 	X(WindowState, window_state, WindowState::Windowed, \
 	  "Default window state when the window is opened, one of Windowed, Borderless, or Fullscreen") \
 	X(int, window_width, 800, "values below 800 aren't supported") \
-	X(int, window_height, 600, "values below 600 aren't supported")
+	X(int, window_height, 600, "values below 600 aren't supported") \
+	X(bool, record_state_hashes, false, \
+	  "Store a hash of the game state on every tick in replays, for finding where replays desync; makes replays much larger") \
+	X(int, hitch_budget_ms, 50, \
+	  "When a frame takes longer than this many milliseconds, the timings of the last few seconds of frames are written to the data folder; 0 to disable") \
+	X(int, max_catch_up_ms, 250, \
+	  "The most time in milliseconds that the physics catches up on in one frame after a slow frame, past which the game slows down instead; 0 for no limit")
 
 struct Config {
 #define X(type, name, default, comment) \
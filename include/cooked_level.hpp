@@ -0,0 +1,66 @@
+#pragma once
+
+#include <cstdint>
+#include <optional>
+#include <string>
+
+#include "level_data.hpp"
+#include "tile_grid.hpp"
+
+/*
+ * binary "cooked" level format, generated from the level images at build
+ * time by the cook tool (see tools/cook.cpp)
+ *
+ * Cooked levels are memory mapped when loaded, and the tile chunks are used
+ * in place, so loading a level doesn't need to decode a png or scan through
+ * every pixel.
+ *
+ * The layout of a cooked level file is as follows (native byte order, all
+ * offsets relative to the start of the file):
+ *  - a Header
+ *  - palette_len PaletteEntry's, at palette_offset
+ *  - chunks_w*chunks_h uint32_t's at chunk_table_offset; 0 means the chunk is
+ *    empty, otherwise it is the chunk's (1-based) index into the chunk data
+ *  - filled_chunks TileGrid::Chunk's at chunk_data_offset
+ *  - text_count TextEntry's at text_offset, each followed by len bytes of
+ *    text, padded to a multiple of four bytes
+ */
+
+struct CookedLevel {
+	static constexpr char MAGIC[8] = { 'P', 'L', 'A', 'T', 'L', 'V', 'L', '\0' };
+	static constexpr uint32_t VERSION = 1;
+
+	struct Header {
+		char magic[8];
+		uint32_t version;
+		uint32_t w, h;
+		float spawn_x, spawn_y;
+		uint32_t palette_len;
+		uint32_t filled_chunks;
+		uint32_t text_count;
+		uint64_t palette_offset;
+		uint64_t chunk_table_offset;
+		uint64_t chunk_data_offset;
+		uint64_t text_offset;
+	};
+	struct PaletteEntry {
+		uint8_t type;
+		uint8_t in_front;
+		uint8_t r, g, b, a;
+		uint8_t padding[2];
+		float bounce_top, bounce_bottom, bounce_side;
+		float friction;
+	};
+	struct TextEntry {
+		uint8_t r, g, b, a;
+		float x, y;
+		uint32_t len;
+	};
+
+	// where the cooked version of a level image is stored
+	static std::string path_for(const std::string &image_path);
+
+	// returns an empty optional if the file doesn't exist or is invalid
+	static std::optional<LevelData> load(const std::string &path);
+	static bool save(const std::string &path, const LevelData &level);
+};
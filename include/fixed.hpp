@@ -0,0 +1,98 @@
+#pragma once
+
+#include <cstdint>
+
+#include "raylib.h"
+
+#include "util.hpp"
+
+/*
+ * the number type the physics is computed in
+ *
+ * By default the physics uses Q16.16 fixed point numbers: integer arithmetic
+ * gives exactly the same results on every platform, compiler, and set of
+ * optimisation flags, unlike floating point arithmetic (where eg. x87 vs SSE,
+ * fused multiply-adds, or a different libm can change the last bits of a
+ * result). Defining FLOAT_PHYSICS switches back to floats.
+ */
+
+namespace util {
+
+// a signed Q16.16 fixed point number: 16 integer bits and 16 fractional bits,
+// so a range of about +-32768 with a precision of 1/65536
+class Fixed {
+	int32_t raw = 0;
+
+public:
+	static constexpr int FRACTION_BITS = 16;
+	static constexpr int32_t ONE = 1 << FRACTION_BITS;
+
+	constexpr Fixed() = default;
+	// only ints within +-32767 fit; nothing checks this here (it is on
+	// every hot path), which is why levels are limited in size, see
+	// LevelData::MAX_WIDTH
+	constexpr Fixed(int i) : raw(int32_t(uint32_t(i) << FRACTION_BITS)) { }
+	// rounds to the nearest representable number, so that constants like
+	// 0.1f come out the same no matter how the float was computed
+	explicit constexpr Fixed(float f)
+	: raw(int32_t(f >= 0 ? f*ONE + 0.5f : f*ONE - 0.5f)) { }
+	// otherwise floats and doubles would silently be truncated to ints and
+	// converted from those
+	Fixed(double) = delete;
+
+	static constexpr Fixed from_raw(int32_t raw) {
+		Fixed res;
+		res.raw = raw;
+		return res;
+	}
+	constexpr int32_t get_raw() const { return raw; }
+
+	explicit constexpr operator float() const { return float(raw) / ONE; }
+	// rounds towards zero, like converting a float to an int does
+	explicit constexpr operator int() const { return raw / ONE; }
+
+	// as friends rather than members, so that ints are converted on either
+	// side of an operator
+	friend constexpr Fixed operator-(Fixed f) { return from_raw(-f.raw); }
+	friend constexpr Fixed operator+(Fixed a, Fixed b) { return from_raw(a.raw + b.raw); }
+	friend constexpr Fixed operator-(Fixed a, Fixed b) { return from_raw(a.raw - b.raw); }
+	friend constexpr Fixed operator*(Fixed a, Fixed b) {
+		return from_raw(int32_t((int64_t(a.raw) * b.raw) >> FRACTION_BITS));
+	}
+	friend constexpr Fixed operator/(Fixed a, Fixed b) {
+		return from_raw(int32_t(int64_t(a.raw) * ONE / b.raw));
+	}
+	// the same as converting the int to a Fixed first, but cheaper
+	friend constexpr Fixed operator/(Fixed a, int b) { return from_raw(a.raw / b); }
+
+	constexpr Fixed &operator+=(Fixed other) { return *this = *this + other; }
+	constexpr Fixed &operator-=(Fixed other) { return *this = *this - other; }
+	constexpr Fixed &operator*=(Fixed other) { return *this = *this * other; }
+
+	friend constexpr bool operator==(Fixed a, Fixed b) { return a.raw == b.raw; }
+	friend constexpr bool operator!=(Fixed a, Fixed b) { return a.raw != b.raw; }
+	friend constexpr bool operator<(Fixed a, Fixed b) { return a.raw < b.raw; }
+	friend constexpr bool operator<=(Fixed a, Fixed b) { return a.raw <= b.raw; }
+	friend constexpr bool operator>(Fixed a, Fixed b) { return a.raw > b.raw; }
+	friend constexpr bool operator>=(Fixed a, Fixed b) { return a.raw >= b.raw; }
+
+	friend constexpr Fixed abs(Fixed f) { return f.raw < 0 ? -f : f; }
+};
+
+// the bits of a number, for hashing it
+inline uint32_t bits(Fixed f) { return uint32_t(f.get_raw()); }
+uint32_t bits(float f);
+
+}
+
+#ifdef FLOAT_PHYSICS
+using Scalar = float;
+#else
+using Scalar = util::Fixed;
+#endif
+using Vec2 = util::BasicVector2<Scalar>;
+using Rect = util::BasicRectangle<Scalar>;
+
+// conversions between the physics' vectors and raylib's, eg. for drawing
+inline Vec2 to_vec2(Vector2 v) { return { Scalar(v.x), Scalar(v.y) }; }
+inline Vector2 to_vector2(Vec2 v) { return { float(v.x), float(v.y) }; }
@@ -0,0 +1,86 @@
+#pragma once
+
+#include <cstdint>
+
+/*
+ * A fixed timestep scheduler, which turns the time passed between frames into
+ * a whole number of physics ticks to run
+ *
+ * The time is accumulated as a count of ticks in 32.32 fixed point, so adding
+ * up many frames doesn't drift the way adding up float seconds does, and
+ * exact tick counts (as headless runs use) stay exact. When a slow frame
+ * leaves several ticks due, they are all run on the next frame to catch up,
+ * up to a cap, so that a long hitch can't make every frame after it slower
+ * still; the time for any ticks over the cap is dropped.
+ *
+ * The time passed can also be scaled, for slow motion or fast-forward.
+ */
+
+class FixedStepScheduler {
+public:
+	static constexpr int FRACTION_BITS = 32;
+	static constexpr uint64_t ONE_TICK = uint64_t(1) << FRACTION_BITS;
+	// as the max ticks per frame, for never dropping any ticks
+	static constexpr uint32_t UNLIMITED = 0;
+
+	// the time accumulated towards the next tick, which is all that
+	// restoring a level needs to restore
+	struct Snapshot {
+		uint64_t accumulated;
+	};
+
+private:
+	int tick_rate;
+	uint32_t max_ticks;
+	double time_scale = 1;
+	// in ticks, as 32.32 fixed point
+	uint64_t accumulated = 0;
+	uint64_t dropped = 0;
+
+	uint64_t take_due();
+public:
+	FixedStepScheduler(int tick_rate, uint32_t max_ticks_per_frame = UNLIMITED);
+
+	Snapshot snapshot() const { return { accumulated }; }
+	void restore(const Snapshot &snapshot) { accumulated = snapshot.accumulated; }
+
+	int get_tick_rate() const { return tick_rate; }
+	double get_time_scale() const { return time_scale; }
+	// 1 for real time, less than 1 for slow motion, more for fast-forward
+	void set_time_scale(double scale);
+	// the number of ticks dropped for going over the cap so far
+	uint64_t get_dropped() const { return dropped; }
+
+	// adds the given number of seconds (as scaled by the time scale), and
+	// returns the number of ticks now due, which are taken off the time
+	// accumulated
+	uint64_t advance(double seconds);
+	// adds exactly the given number of ticks' worth of time instead (fewer
+	// than 2^32 at a time)
+	uint64_t advance_ticks(uint64_t ticks);
+
+	// how far the time accumulated is towards the next tick, from 0 to 1,
+	// for interpolating between the last two ticks
+	float alpha() const;
+
+	// advances by the given time, calling tick for each tick due; tick
+	// may return false to stop early (eg. once the level is completed),
+	// in which case the ticks left are dropped. Returns the ticks run.
+	template<typename F>
+	uint64_t run(double seconds, F tick) {
+		return run_due(advance(seconds), tick);
+	}
+	template<typename F>
+	uint64_t run_ticks(uint64_t ticks, F tick) {
+		return run_due(advance_ticks(ticks), tick);
+	}
+
+private:
+	template<typename F>
+	uint64_t run_due(uint64_t due, F &tick) {
+		for (uint64_t i = 0; i < due; ++i) {
+			if (!tick()) return i + 1;
+		}
+		return due;
+	}
+};
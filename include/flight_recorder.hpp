@@ -0,0 +1,105 @@
+#pragma once
+
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <thread>
+
+/*
+ * A flight recorder for catching hitches (frames that take much longer than
+ * they should) where they happen, rather than trying to reproduce them
+ *
+ * It always keeps the timings of the last few seconds of frames, and when a
+ * frame takes longer than the budget set in the config (hitch_budget_ms),
+ * the recorded frames are written to a file in the data folder by a
+ * background thread, so that writing them doesn't cause another hitch.
+ *
+ * Recording a frame costs a handful of clock reads and stores, so unlike the
+ * profiler it is compiled into release builds as well.
+ */
+
+class FlightRecorder {
+public:
+	struct Frame {
+		uint64_t number;
+		// all in milliseconds
+		float total;
+		float update; // including the input handling
+		float draw;
+		float present; // EndDrawing, ie. swapping buffers and waiting for the next frame
+		uint32_t physics_ticks;
+		// the raylib draw functions called, of which rectangles drew
+		// rectangles (raylib batches these into fewer GPU draw calls)
+		uint32_t draw_calls;
+		uint32_t rectangles;
+		uint32_t allocations;
+		// the input presses applied on the frame's physics ticks, and
+		// their total latency in milliseconds
+		uint32_t inputs;
+		float input_latency;
+	};
+
+	// about four seconds at 60 FPS
+	static constexpr size_t CAPACITY = 1 << 8;
+	static constexpr size_t MASK = CAPACITY - 1;
+	// so that a game that keeps on hitching doesn't fill up the disk
+	static constexpr int MAX_DUMPS = 16;
+
+private:
+	using clock = std::chrono::steady_clock;
+
+	Frame frames[CAPACITY] = {};
+	uint64_t frame_nr = 0;
+	clock::time_point frame_start, update_end, present_start;
+	uint32_t physics_ticks = 0;
+	uint32_t draw_calls = 0;
+	uint32_t rectangles = 0;
+	uint32_t inputs = 0;
+	float input_latency = 0;
+	uint64_t allocations_at_start = 0;
+	// no frame is written to more than one dump
+	uint64_t first_undumped = 0;
+	int dumps = 0;
+
+	// the frames to be written are copied here and handed to the writer
+	// thread, which is only started on the first hitch
+	std::mutex dump_mutex;
+	std::condition_variable dump_cv;
+	std::unique_ptr<Frame[]> dump_frames;
+	size_t dump_count = 0;
+	bool dump_pending = false;
+	bool stopping = false;
+	std::thread writer;
+
+	FlightRecorder() = default;
+	~FlightRecorder();
+
+	void dump();
+	void write_dumps();
+public:
+	static FlightRecorder &get();
+
+	FlightRecorder(const FlightRecorder&) = delete;
+	FlightRecorder &operator=(const FlightRecorder&) = delete;
+
+	// the phases of a frame, in the order they happen in
+	void begin_frame();
+	void end_update();
+	void begin_present();
+	void end_frame();
+
+	void count_physics_tick() { ++physics_ticks; }
+	void count_draw_calls(uint32_t n = 1) { draw_calls += n; }
+	void count_rectangles(uint32_t n = 1) { draw_calls += n; rectangles += n; }
+	void count_input(float latency_ms) { ++inputs; input_latency += latency_ms; }
+
+	// the number of frames recorded so far
+	uint64_t frame_count() const { return frame_nr; }
+	// one of the last CAPACITY frames recorded
+	const Frame &frame(uint64_t number) const { return frames[number & MASK]; }
+
+	// blocks until the dump being written (if any) is on disk
+	void wait_for_dumps();
+};
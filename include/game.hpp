@@ -2,6 +2,8 @@
 
 #include <memory>
 
+#include "actions.hpp"
+#include "perf_hud.hpp"
 #include "scene.hpp"
 
 // the game class implements all the program logic;
@@ -10,6 +12,10 @@
 
 class Game {
 	std::unique_ptr<Scene> scene;
+	PerfHud perf_hud;
+#ifdef DEBUG
+	ActionOnce::cb_handle_t export_trace_action;
+#endif
 public:
 	Game();
 
@@ -1,5 +1,10 @@
 #pragma once
 
+// the physics tick rate can be set in the build config
+#ifndef PHYSICS_TICK_RATE
+#define PHYSICS_TICK_RATE 32
+#endif
+
 struct Config;
 namespace global {
 
@@ -9,8 +14,15 @@ extern int WINDOW_WIDTH;
 extern int WINDOW_HEIGHT;
 extern const int PPU; // pixels per unit
 extern bool quit;
-extern const int PHYSICS_FPS;
+// report heap allocations made while playing a level (--check-allocs)
+extern bool check_allocs;
+extern unsigned allocating_frames;
+// the ticks per second of the physics, and what it was tuned at (personal
+// bests and replays made at any other rate are kept apart)
+inline constexpr int PHYSICS_FPS = PHYSICS_TICK_RATE;
+inline constexpr int DEFAULT_PHYSICS_FPS = 32;
 extern const char *DATA_DIR;
 extern const char *PERSONAL_BESTS_FILE;
+extern const char *REPLAYS_DIR; // inside of DATA_DIR
 
 }
@@ -97,19 +97,13 @@ struct Text {
 	bool centered;
 	Color color;
 
-	Vector2 abs_pos() const {
-		// from raylib/src/rtext.c:1195
-		const float spacing = font_size / 10.0f;
-
-		const auto size = MeasureTextEx(
-			GetFontDefault(), text.c_str(), font_size, spacing
-		);
+	// the text's width when it was last measured, as checking whether the
+	// text has changed is a lot cheaper than measuring it again every frame
+	mutable std::string measured_text = {};
+	mutable int measured_size = -1;
+	mutable float measured_width = 0;
 
-		if (centered) {
-			const float x_centre = global::WINDOW_WIDTH / 2.0f - pos.x;
-			return { x_centre - size.x/2, pos.y };
-		} else return pos;
-	}
+	Vector2 abs_pos() const;
 
 	void draw() const;
 };
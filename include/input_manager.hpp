@@ -1,7 +1,9 @@
 #pragma once
 
+#include <array>
+#include <cstdint>
 #include <functional>
-#include <unordered_map>
+#include <vector>
 
 #include "raylib.h"
 
@@ -10,22 +12,89 @@
  * Calls callbacks on key press, key release, or while key down
  */
 
+// a set of keys, as one bit per key code
+class KeySet {
+public:
+	// raylib's key codes go up to KEY_KB_MENU
+	static constexpr int KEY_COUNT = KEY_KB_MENU + 1;
+
+private:
+	static constexpr int WORDS = (KEY_COUNT + 63) / 64;
+	uint64_t words[WORDS] = {};
+
+public:
+	static constexpr bool valid(int key) { return key >= 0 && key < KEY_COUNT; }
+
+	void set(int key) { words[key >> 6] |= uint64_t(1) << (key & 63); }
+	void reset(int key) { words[key >> 6] &= ~(uint64_t(1) << (key & 63)); }
+	bool test(int key) const { return words[key >> 6] >> (key & 63) & 1; }
+
+	friend KeySet operator&(const KeySet &a, const KeySet &b) {
+		KeySet res;
+		for (int i = 0; i < WORDS; ++i) res.words[i] = a.words[i] & b.words[i];
+		return res;
+	}
+	friend KeySet operator|(const KeySet &a, const KeySet &b) {
+		KeySet res;
+		for (int i = 0; i < WORDS; ++i) res.words[i] = a.words[i] | b.words[i];
+		return res;
+	}
+	friend KeySet operator^(const KeySet &a, const KeySet &b) {
+		KeySet res;
+		for (int i = 0; i < WORDS; ++i) res.words[i] = a.words[i] ^ b.words[i];
+		return res;
+	}
+
+	// calls f with each key in the set, in order of key code; only visits
+	// the keys in the set (and the empty words), not every key code
+	template<typename F>
+	void for_each(F f) const {
+		for (int i = 0; i < WORDS; ++i) {
+			for (uint64_t word = words[i]; word != 0; word &= word - 1) {
+				f(KeyboardKey(i*64 + __builtin_ctzll(word)));
+			}
+		}
+	}
+};
+
 class InputManager {
-	std::unordered_map<KeyboardKey, const std::function<void()>> pressCallbacks;
-	std::unordered_map<KeyboardKey, const std::function<void()>> releaseCallbacks;
-	std::unordered_map<KeyboardKey, const std::function<void(float dt)>> sustainCallbacks;
+	// the callbacks bound to each key, indexed by key code
+	template<typename T>
+	using bindings_t = std::array<std::vector<T>, KeySet::KEY_COUNT>;
+	bindings_t<std::function<void()>> pressCallbacks;
+	bindings_t<std::function<void()>> releaseCallbacks;
+	bindings_t<std::function<void(float dt)>> sustainCallbacks;
+
+	// the keys with callbacks of each kind, and of any kind
+	KeySet pressKeys;
+	KeySet releaseKeys;
+	KeySet sustainKeys;
+	KeySet boundKeys;
+	// the bound keys that were down as of the last handleInputs
+	KeySet downKeys;
 
 	// the constructor is declared private to prevent new InputManager
 	// instances from being created; other code can only obtain a
 	// InputManager from the get method
 	InputManager();
+
+	void updateBoundKeys();
 public:
 	static InputManager& get();
 
-	void handleInputs() const;
+	// takes a snapshot of the bound keys, and calls the callbacks of the
+	// keys which were pressed or released since the last call, and of the
+	// keys which are down; callbacks may not be (de)registered meanwhile
+	//
+	// a key pressed and released again since the last call still has its
+	// press and then its release callbacks called
+	void handleInputs();
 
+	// a key may have any number of callbacks of each kind, which are
+	// called in the order they were registered in
 	void registerPress(KeyboardKey key, const std::function<void()> callback);
 	void registerRelease(KeyboardKey key, const std::function<void()> callback);
+	// removes all of the key's callbacks of that kind
 	void deregisterPress(KeyboardKey key);
 	void deregisterRelease(KeyboardKey key);
 
@@ -1,63 +1,56 @@
 #pragma once
 
+#include <cstdint>
 #include <memory>
 #include <optional>
 #include <string>
+#include <utility>
 #include <vector>
 
 #include "raylib.h"
 
 #include "actions.hpp"
+#include "chunk_renderer.hpp"
+#include "fixed_step.hpp"
+#include "level_data.hpp"
 #include "overlay.hpp"
 #include "player.hpp"
+#include "replay.hpp"
+#include "simulation.hpp"
 #include "stats.hpp"
+#include "tile_grid.hpp"
 
 /*
  * the main core of the game:
- * handles the 2D array of tiles, the player, and the camera
+ * runs a level's simulation, and handles its camera, rendering, and overlays
  */
 
-enum class TileType { Empty, Solid, Danger, Goal, Checkpoint };
-
-struct Tile {
-	struct Bounce {
-		float top = 0;
-		float bottom = 0;
-		float side = 0;
-	};
-
-	constexpr Tile() : type(TileType::Empty), color(Color { 0, 0, 0, 0 }), in_front(false) {}
-	constexpr Tile(Color color) : type(TileType::Solid), color(color), in_front(false) {}
-	constexpr Tile(Color color, TileType type) : type(type), color(color), in_front(false) {}
-	constexpr Tile(Color color, TileType type, bool in_front) : type(type), color(color), in_front(in_front) {}
-	constexpr Tile(Color color, TileType type, bool in_front, Bounce bounce, float friction) : type(type), color(color), in_front(in_front), bounce(bounce), friction(friction) {}
-
-	TileType type;
-	Color color;
-	bool in_front;
-	Bounce bounce;
-	float friction = 12;
-};
-
-class Level;
-struct LevelText {
-	std::string text;
-	Color color;
-	Vector2 pos;
-
-	void draw(const Level &level, const Camera2D &camera) const;
-};
-
 class Level {
 public:
 	enum class State { Active, Paused, WinScreen };
 	enum class Change { None, Prev, Next, Reset, MainMenu };
 
+	// the level's mutable state; restoring a snapshot is cheap (no
+	// allocations or callback registrations), which is what makes
+	// restarting a level instant
+	struct Snapshot {
+		Simulation::Snapshot sim;
+		Camera2D camera;
+		float camera_move_time;
+		State state;
+		bool has_populated_winscreen;
+		FixedStepScheduler::Snapshot scheduler;
+		Change change;
+	};
+
 private:
-	const std::vector<Tile> tiles;
+	std::shared_ptr<const LevelData> data;
+	const TileGrid &tiles;
 	int w, h;
-	std::unique_ptr<Player> player;
-	Vector2 player_spawn;
+	Simulation sim;
+	PlayerControls controls;
+	// the inputs of the current attempt, saved on a new personal best
+	Replay recording;
 	Camera2D camera;
 	size_t level_nr;
 	std::vector<LevelText> texts = {};
@@ -67,30 +60,55 @@ private:
 	Overlay pause_overlay;
 	bool has_populated_winscreen = false;
 	Overlay win_overlay;
-	float frame_acc = 0;
-	Stats stats{};
+	// decides how many physics ticks to run each frame
+	FixedStepScheduler scheduler;
 	bool continuous = false;
-	std::optional<Vector2> active_checkpoint = {};
+	// the state right after construction, restored by reset
+	Snapshot initial_snapshot;
+	// baked when the level is created, or for large levels a few chunks a
+	// frame ahead of the camera (see bake_ahead), never while drawing
+	ChunkRenderer chunk_renderer;
+	// the faded tiles in front of the player, collected while drawing the
+	// ones behind it; kept around (with room for all of the level's tiles
+	// in front) so that drawing doesn't allocate
+	mutable std::vector<std::pair<Rectangle, Color>> draw_after = {};
+
+	// for --check-allocs: the allocation count at the start of the last
+	// update, and whether the level was being played then
+	uint64_t allocations_at_update = 0;
+	bool was_active = false;
+	void check_allocations();
+
+	// bakes at most budget chunks of those on screen or near it, the ones
+	// on screen first
+	void bake_ahead(size_t budget);
 
 	ActionOnce::cb_handle_t reset_action;
 	ActionOnce::cb_handle_t next_level_action;
+	#ifdef DEBUG
+	ActionOnce::cb_handle_t slow_down_action;
+	ActionOnce::cb_handle_t speed_up_action;
+	#endif
 
 	const float camera_play = 4;
 	const float camera_follow = 0.5f;
 	const float camera_min_move_time = 0.25;
-
-	Level(
-		size_t level_nr, std::vector<Tile> tiles, int w, int h,
-		Vector2 player_spawn, bool continuous
-	);
 public:
-	float gravity = 20;
 	Change change = Change::None;
 
 	Vector2 get_offset() const;
 	int get_level_nr() const;
 	const Stats &get_stats() const;
+	const Simulation &get_simulation() const;
 
+	Level(
+		size_t level_nr, std::shared_ptr<const LevelData> data,
+		bool continuous
+	);
+	Level(
+		size_t level_nr, TileGrid tiles, Vector2 player_spawn,
+		bool continuous
+	);
 	Level(
 		size_t level_nr, const Tile *tilemap, int w, int h,
 		Vector2 player_spawn, bool continuous
@@ -106,14 +124,11 @@ public:
 	);
 	void add_texts(std::vector<LevelText> texts);
 	~Level();
-	Vector2 get_player_spawn() const;
-
-	void respawn_player();
-	void display_win_overlay();
 
-	Rectangle get_collider(float x, float y) const;
-	Tile get_tile(float x, float y) const;
-	void activate_checkpoint(float x, float y);
+	Snapshot snapshot() const;
+	void restore(const Snapshot &snapshot);
+	// restarts the level in place, as if it were newly created
+	void reset();
 
 	void update(float dt);
 	void draw() const;
@@ -149,4 +164,7 @@ static constexpr struct {
 	{ { 15, 195, 195, 255 },  checkpoint },
 };
 
+// converts a level image into tiles using the colormap
+TileGrid tilemap_of(Image image);
+
 }
@@ -0,0 +1,50 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "raylib.h"
+
+#include "collider_mesh.hpp"
+#include "tile_grid.hpp"
+
+/*
+ * the static data a level is made up of, as loaded from the level files
+ */
+
+class Level;
+struct LevelText {
+	std::string text;
+	Color color;
+	Vector2 pos;
+
+	void draw(const Level &level, const Camera2D &camera) const;
+};
+
+// the immutable part of a level, as decoded from its image or cooked file;
+// it is shared between every Level created from the same file, so restarting
+// a level doesn't need to decode it again (see Levels::load_level_data)
+struct LevelData {
+	TileGrid tiles;
+	Vector2 spawn;
+	std::vector<LevelText> texts;
+	// built from the tiles
+	ColliderMesh colliders;
+	// a hash of the tiles and spawn position, ie. of everything that affects
+	// the level's simulation; replays store it to detect changed levels
+	uint64_t content_hash;
+
+	// The physics' Q16.16 numbers (see fixed.hpp) only reach about +-32768.
+	// A level spans -w/2 to w/2 across and -h to 0 down (see
+	// Simulation::get_offset), but positions are also turned into tile
+	// coordinates from 0 to w (or h), so in a level larger than this
+	// either would silently wrap around; this leaves the player some room
+	// past the edges.
+	static constexpr int64_t MAX_WIDTH = 32000;
+	static constexpr int64_t MAX_HEIGHT = 32000;
+	// prints an error naming the level's file if it is too large to play
+	static bool check_size(const std::string &path, int64_t w, int64_t h);
+
+	LevelData(TileGrid tiles, Vector2 spawn, std::vector<LevelText> texts);
+};
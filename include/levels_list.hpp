@@ -23,6 +23,18 @@ struct LevelInfo {
 
 extern const std::vector<LevelInfo> levels;
 
+// returns the decoded data of the given level, or nullptr if the index is
+// invalid or the level can't be loaded (eg. it is too large to play); the
+// data is cached, and is only decoded again if the level's files have changed
+// since
+std::shared_ptr<const LevelData> load_level_data(size_t idx);
+// starts loading the given level's data on a worker thread, so that creating
+// the level later on doesn't have to wait for the disk; does nothing if the
+// index is invalid
+void prefetch_level_data(size_t idx);
+
+// uses the level's prefetched data if there is any, and starts prefetching
+// the level after it; returns nullptr if the level can't be loaded
 std::unique_ptr<Level> make_level(size_t idx);
 std::unique_ptr<Level> make_level(size_t idx, bool continuous);
 
@@ -0,0 +1,29 @@
+#pragma once
+
+#include <cstddef>
+#include <memory>
+
+/*
+ * read-only memory mapping of a whole file, unmapped when destroyed
+ */
+
+class MappedFile {
+	const unsigned char *ptr = nullptr;
+	size_t len = 0;
+#ifdef _WIN32
+	void *file = nullptr;
+	void *mapping = nullptr;
+#endif
+
+	MappedFile() = default;
+public:
+	// returns nullptr if the file could not be opened or mapped
+	static std::shared_ptr<const MappedFile> open(const char *path);
+	~MappedFile();
+
+	MappedFile(const MappedFile&) = delete;
+	MappedFile &operator=(const MappedFile&) = delete;
+
+	const unsigned char *data() const { return ptr; }
+	size_t size() const { return len; }
+};
@@ -0,0 +1,63 @@
+#pragma once
+
+#include <cstdint>
+
+#include "actions.hpp"
+#include "flight_recorder.hpp"
+
+/*
+ * A performance HUD, showing the frame time percentiles and the average
+ * costs of a frame over the last couple of seconds, as recorded by the
+ * flight recorder
+ *
+ * The frame times are kept in a fixed-size histogram and the other values as
+ * running sums, which are updated as frames enter and leave the window, so
+ * neither updating nor drawing the HUD has to go over all the frames.
+ */
+
+class PerfHud {
+public:
+	// about two seconds at 60 FPS; less than the flight recorder keeps, so
+	// that a frame leaving the window can still be looked up
+	static constexpr uint64_t WINDOW = FlightRecorder::CAPACITY / 2;
+	// frame times are put into buckets of 0.25 ms, up to 64 ms; slower
+	// frames all go into the last bucket
+	static constexpr int BUCKETS = 256;
+	static constexpr float BUCKET_MS = 0.25f;
+
+private:
+	uint16_t histogram[BUCKETS] = {};
+	// the totals over the frames in the window, with the times in
+	// microseconds so that removing a frame exactly undoes adding it
+	struct Sums {
+		int64_t update;
+		int64_t draw;
+		int64_t present;
+		int64_t physics_ticks;
+		int64_t draw_calls;
+		int64_t rectangles;
+		int64_t allocations;
+		int64_t inputs;
+		int64_t input_latency;
+	} sums = {};
+	// frames [first, next) are in the window
+	uint64_t first = 0;
+	uint64_t next = 0;
+
+	bool visible;
+	ActionOnce::cb_handle_t toggle_action;
+
+	void add(const FlightRecorder::Frame &frame, int64_t sign);
+	// the frame time (in ms) that the given fraction of the frames in the
+	// window were at most
+	float percentile(float p) const;
+public:
+	PerfHud();
+
+	PerfHud(const PerfHud&) = delete;
+	PerfHud &operator=(const PerfHud&) = delete;
+
+	// takes in the frames recorded since the last update
+	void update();
+	void draw() const;
+};
@@ -1,11 +1,15 @@
 #pragma once
 
+#include <cstddef>
 #include <cstdint>
 
 #include "raylib.h"
 
 #include "actions.hpp"
+#include "callback_list.hpp"
+#include "fixed.hpp"
 #include "stats.hpp"
+#include "util.hpp"
 
 // class for handling physics simulation and rendering of the player
 
@@ -26,46 +30,120 @@ enum class MotionInputs : uint8_t {
 	Fly = (1 << 4),
 	#endif
 	Slam = (1 << 5),
+	Suicide = (1 << 6),
 };
 
-class Level;
+class Simulation;
 class Player {
-	Vector2 prev_pos = { 0, 0 };
-	Vector2 pos = { 0, 0 };
-	Vector2 vel = { 0, 0 };
+	Vec2 prev_pos = { 0, 0 };
+	Vec2 pos = { 0, 0 };
+	Vec2 vel = { 0, 0 };
 	MotionInputs inputs = MotionInputs::None;
 	JumpState jumpstate = JumpState::DoubleJumped;
+	int coyote_frames_left = 0;
 	bool killed = false;
 	bool level_completed = false;
-	ActionSustain::cb_handle_t jump_action;
-	ActionOnce::cb_handle_t double_jump_action;
-	ActionSustain::cb_handle_t slam_action;
-	ActionSustain::cb_handle_t walk_left_action;
-	ActionSustain::cb_handle_t walk_right_action;
-	#ifdef DEBUG
-	ActionSustain::cb_handle_t fly_action;
-	#endif
-	ActionOnce::cb_handle_t suicide_action;
 	Stats &stats;
 
-	static constexpr Vector2 size = Vector2 { 1.0f, 2.0f };
-	static constexpr float jump_vel = 13; // set to 13.25 for much easier 8-block double jumps
-	static constexpr float walk_acc = 16;
-	static constexpr float walk_dec = 32;
-	static constexpr float walk_vel = 20;
-	static constexpr int coyote_frames = 2;
+	static constexpr Vec2 size = Vec2 { 1, 2 };
+	static constexpr Scalar jump_vel = 13; // set to 13.25 for much easier 8-block double jumps
+	static constexpr Scalar walk_acc = 16;
+	static constexpr Scalar walk_dec = 32;
+	static constexpr Scalar walk_vel = 20;
+	// how long after walking off a ledge a jump is still allowed, in
+	// seconds (two ticks at 32 ticks per second)
+	static constexpr float coyote_time = 0.0625f;
 
-	bool on_ground(Level &level);
 	bool test_input(MotionInputs input);
 
-	void resolve_collisions_x(Level &level);
-	void resolve_collisions_y(Level &level);
+	void resolve_collisions_x(Simulation &sim);
+	void resolve_collisions_y(Simulation &sim);
 public:
+	// the player's mutable simulation state, which allows restoring the
+	// player in place rather than recreating it
+	struct Snapshot {
+		Vec2 prev_pos;
+		Vec2 pos;
+		Vec2 vel;
+		JumpState jumpstate;
+		int coyote_frames_left;
+		bool killed;
+		bool level_completed;
+	};
+
 	Player(Stats &stats);
 
+	Snapshot snapshot() const;
+	void restore(const Snapshot &snapshot);
+	// mixes the player's simulation state into the hash
+	void hash_state(util::Hash &hash) const;
+
+	// whether the player is standing on a solid tile
+	bool on_ground(const Simulation &sim) const;
+
+	// for drawing, interpolated between the last two ticks
 	Vector2 get_pos(float interp) const;
-	void spawn(Vector2 pos);
+	void spawn(Vec2 pos);
 
-	void update(Level &level);
+	// advances the player by one physics tick, given the inputs held
+	// during that tick
+	void update(Simulation &sim, MotionInputs tick_inputs);
 	void draw(float interp) const;
 };
+
+// a press or release of one of the player's inputs, with the time (as from
+// GetTime) that the input manager polled it at
+struct InputEvent {
+	MotionInputs input;
+	bool pressed;
+	double time;
+};
+
+// queues the player's input events from the input actions, until they are
+// taken for the next physics tick
+//
+// Rather than sampling which keys are down, the events are applied in order at
+// the tick, so that a key pressed and released again between two ticks still
+// counts for the next tick, and each press can be timed from when it was
+// polled to the tick it was applied on.
+class PlayerControls {
+public:
+	// far more events than can come in between two ticks
+	static constexpr size_t QUEUE_CAPACITY = 32;
+	// called with each press applied when taking the inputs
+	using on_press_t = InlineFunction<void(MotionInputs input, double time)>;
+
+private:
+	InputEvent queue[QUEUE_CAPACITY] = {};
+	size_t queued = 0;
+	// the inputs held down as of the last event applied
+	MotionInputs held = MotionInputs::None;
+	// the inputs pressed since they were last taken, of the events applied
+	// already
+	MotionInputs pressed = MotionInputs::None;
+
+	ActionStartStop::cb_handle_t jump_action;
+	ActionOnce::cb_handle_t double_jump_action;
+	ActionStartStop::cb_handle_t slam_action;
+	ActionStartStop::cb_handle_t walk_left_action;
+	ActionStartStop::cb_handle_t walk_right_action;
+	#ifdef DEBUG
+	ActionStartStop::cb_handle_t fly_action;
+	#endif
+	ActionOnce::cb_handle_t suicide_action;
+
+	void push(MotionInputs input, bool pressed);
+	void apply_queued(on_press_t on_press);
+public:
+	PlayerControls();
+
+	PlayerControls(const PlayerControls&) = delete;
+	PlayerControls &operator=(const PlayerControls&) = delete;
+
+	// applies the queued events, and returns the inputs for the next tick:
+	// those held down, and those pressed since the inputs were last taken
+	MotionInputs take(on_press_t on_press);
+	// drops the presses since the inputs were last taken, keeping only
+	// track of which inputs are held down
+	void clear();
+};
@@ -0,0 +1,53 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+
+/*
+ * a zone profiler, for seeing where the time of a frame goes without an
+ * external profiler
+ *
+ * A zone is a scope marked with PROFILE_ZONE("name"); the time from that line
+ * to the end of the scope is recorded every time the scope is run. Each
+ * thread records its zones into its own ring buffer (which keeps the most
+ * recent zones, overwriting the oldest ones), so recording never waits on a
+ * lock or on the other threads.
+ *
+ * The recorded zones can be exported as a Chrome trace (the trace_event JSON
+ * format), which can be opened in chrome://tracing or https://ui.perfetto.dev
+ *
+ * Zones are only recorded in debug builds; in release builds PROFILE_ZONE
+ * compiles to nothing.
+ */
+
+#ifdef DEBUG
+
+namespace profiler {
+
+class Zone {
+	const char *name;
+	uint64_t start;
+public:
+	// the name must outlive the profiler, eg. a string literal
+	explicit Zone(const char *name);
+	~Zone();
+
+	Zone(const Zone&) = delete;
+	Zone &operator=(const Zone&) = delete;
+};
+
+// writes the zones recorded so far (on all threads) to the given file as a
+// Chrome trace
+bool export_trace(const std::string &path);
+
+}
+
+#define PROFILE_ZONE_CONCAT_(a, b) a ## b
+#define PROFILE_ZONE_CONCAT(a, b) PROFILE_ZONE_CONCAT_(a, b)
+#define PROFILE_ZONE(name) const profiler::Zone PROFILE_ZONE_CONCAT(profile_zone_, __LINE__)(name)
+
+#else
+
+#define PROFILE_ZONE(name) do { } while (0)
+
+#endif /* DEBUG */
@@ -0,0 +1,181 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <optional>
+#include <string>
+#include <vector>
+
+#include "level_data.hpp"
+#include "player.hpp"
+#include "simulation.hpp"
+#include "stats.hpp"
+
+/*
+ * recording the player's inputs during a level, and playing them back
+ *
+ * As the physics is deterministic, the inputs given on every tick are all
+ * that is needed to recreate a run through a level. Inputs are mostly held
+ * for many ticks at a time, so they are stored run-length encoded, which
+ * keeps a replay of several minutes down to a few kilobytes.
+ *
+ * Optionally, a replay can also store a hash of the simulation's state after
+ * every tick (see Simulation::state_hash), so that when playing it back, the
+ * exact tick where the playback diverges from the recording can be found.
+ *
+ * The layout of a replay file is as follows (native byte order):
+ *  - a Header
+ *  - data_len bytes of runs, each being one byte of MotionInputs followed by
+ *    the number of ticks they were held for, as an unsigned LEB128 varint
+ *  - hash_count uint64_t state hashes, one per tick (so hash_count is either
+ *    zero or equal to ticks)
+ *  - latency_count Latency records, in order of tick
+ *
+ * Version 2 replays are the same, except that they have no latencies (so
+ * their latency_count, which was padding then, is always zero).
+ */
+
+class Replay {
+public:
+	static constexpr char MAGIC[8] = { 'P', 'L', 'A', 'T', 'R', 'P', 'L', '\0' };
+	static constexpr uint32_t VERSION = 3;
+	// the oldest version which can still be loaded
+	static constexpr uint32_t MIN_VERSION = 2;
+	// bump whenever a change to the physics changes the outcome of a run,
+	// so that replays recorded before then can be told apart
+	static constexpr uint32_t PHYSICS_REVISION = 2;
+
+	struct Header {
+		char magic[8];
+		uint32_t version;
+		uint32_t level_nr;
+		uint64_t content_hash;
+		uint64_t build_id;
+		// the stats of the recorded run
+		uint32_t time, jumps, double_jumps;
+		int32_t deaths, restarts;
+		uint32_t ticks;
+		uint32_t data_len;
+		uint32_t hash_count;
+		uint32_t latency_count;
+	};
+
+	// a number of consecutive ticks with the same inputs
+	struct Run {
+		MotionInputs inputs;
+		uint32_t length;
+	};
+
+	// the input latency of a press: the time from the key press being
+	// polled to the start of the tick it was applied on
+	struct Latency {
+		uint32_t tick;
+		uint32_t micros;
+		MotionInputs input;
+		uint8_t padding[3];
+	};
+
+private:
+	std::vector<Run> runs = {};
+	uint32_t ticks = 0;
+	bool with_hashes = false;
+	// the state hash after each tick, if with_hashes
+	std::vector<uint64_t> hashes = {};
+	std::vector<Latency> latencies = {};
+
+public:
+	size_t level_nr = 0;
+	// the LevelData::content_hash of the level the replay was recorded on
+	uint64_t content_hash = 0;
+	// the build_id of the game that recorded the replay
+	uint64_t build_id = 0;
+	// the stats the recorded run ended with, as claimed by the recorder
+	Stats stats{};
+
+	Replay() = default;
+	// an empty recording for the given level, which records the state
+	// hashes too if with_hashes is set
+	Replay(size_t level_nr, const LevelData &data, bool with_hashes);
+
+	// identifies the physics of this build: the physics revision, the tick
+	// rate, whether it is a debug build, and with float physics, the
+	// compiler
+	static uint64_t current_build_id();
+
+	// makes room for recording the given number of ticks (and runs of
+	// inputs, and as many presses), so that recording them doesn't allocate
+	void reserve(uint32_t ticks, size_t runs);
+	// appends a tick with the given inputs
+	void record(MotionInputs inputs);
+	// sets the state hash of the last recorded tick; only call this if
+	// the replay has hashes
+	void record_hash(uint64_t hash);
+	// records the latency of a press applied on the next tick to be
+	// recorded
+	void record_latency(MotionInputs input, uint32_t micros);
+	// drops all but the first given number of ticks
+	void truncate(uint32_t ticks);
+
+	uint32_t length() const { return ticks; }
+	const std::vector<Run> &get_runs() const { return runs; }
+	bool has_hashes() const { return with_hashes; }
+	const std::vector<uint64_t> &get_hashes() const { return hashes; }
+	const std::vector<Latency> &get_latencies() const { return latencies; }
+
+	// where the replay of the personal best on the given level is stored
+	static std::string path_for(size_t level_nr);
+
+	// returns an empty optional if the file doesn't exist or is invalid
+	static std::optional<Replay> load(const std::string &path);
+	// creates the file's directory if needed
+	bool save(const std::string &path) const;
+};
+
+// plays a replay back through a headless Simulation of its level
+class ReplayPlayer {
+public:
+	// how many ticks apart the states kept for seeking are
+	static constexpr uint32_t KEYFRAME_INTERVAL = 256;
+
+private:
+	struct Keyframe {
+		Simulation::Snapshot sim;
+		size_t run_ix;
+		uint32_t run_pos;
+	};
+
+	const Replay &replay;
+	Simulation sim;
+	// the run the next tick is in, and how many of its ticks have passed
+	size_t run_ix = 0;
+	uint32_t run_pos = 0;
+	uint32_t tick = 0;
+	std::optional<uint32_t> desync = {};
+	// keyframes[i] is the state after i*KEYFRAME_INTERVAL ticks, filled in
+	// as the replay is played
+	std::vector<Keyframe> keyframes = {};
+
+	void restore(const Keyframe &keyframe, uint32_t tick);
+
+public:
+	// the replay must outlive the player
+	ReplayPlayer(const Replay &replay, std::shared_ptr<const LevelData> data);
+
+	const Simulation &get_simulation() const { return sim; }
+	// the number of ticks played so far
+	uint32_t get_tick() const { return tick; }
+	bool done() const { return tick >= replay.length(); }
+	// the first tick after which the simulation's state didn't match the
+	// recorded state hash, if any; only ever set for replays with hashes
+	const std::optional<uint32_t> &get_desync() const { return desync; }
+
+	// plays the next tick, returns false if the replay is already done
+	bool step();
+	// plays the given number of ticks (or until the end of the replay), and
+	// returns the number of ticks played
+	uint32_t fast_forward(uint32_t ticks);
+	// moves to the state after the given number of ticks, going back to
+	// the nearest keyframe if the tick has already passed
+	void seek(uint32_t tick);
+};
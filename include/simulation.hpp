@@ -0,0 +1,108 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <optional>
+
+#include "raylib.h"
+
+#include "fixed.hpp"
+#include "level_data.hpp"
+#include "player.hpp"
+#include "stats.hpp"
+#include "tile_grid.hpp"
+
+/*
+ * the physics core of a level: the player moving through the level's tiles,
+ * advanced one fixed physics tick at a time
+ *
+ * A simulation doesn't depend on a window, rendering, or input handling in
+ * any way, so levels can also be simulated headlessly (see tools/headless.cpp)
+ */
+
+class Simulation {
+public:
+	// a merged static collider, in world coordinates
+	struct Collider {
+		Rect rect;
+		const Tile *tile;
+	};
+	// the most colliders get_colliders returns at once
+	static constexpr size_t MAX_COLLIDERS = 16;
+
+	// the simulation's mutable state
+	struct Snapshot {
+		Player::Snapshot player;
+		Vector2 player_spawn;
+		std::optional<Vector2> active_checkpoint;
+		Stats stats;
+		Scalar gravity;
+		bool completed;
+	};
+
+private:
+	std::shared_ptr<const LevelData> data;
+	const TileGrid &tiles;
+	int w, h;
+	int tick_rate;
+	// the duration of a tick, 1 / tick_rate
+	Scalar dt;
+	// get_offset, in the physics' number type
+	Vec2 offset;
+	Stats stats{};
+	Player player;
+	Vector2 player_spawn;
+	std::optional<Vector2> active_checkpoint = {};
+	bool completed = false;
+
+public:
+	Scalar gravity = 20;
+
+	// runs at the game's tick rate (global::PHYSICS_FPS)
+	explicit Simulation(std::shared_ptr<const LevelData> data);
+	// runs at the given number of ticks per second instead, eg. for
+	// comparing the cost of the physics at different rates
+	Simulation(std::shared_ptr<const LevelData> data, int tick_rate);
+
+	// the player refers back to the simulation's stats
+	Simulation(const Simulation&) = delete;
+	Simulation &operator=(const Simulation&) = delete;
+
+	// advances the simulation by one tick, with the inputs given during
+	// that tick
+	void tick(MotionInputs inputs);
+
+	int get_tick_rate() const { return tick_rate; }
+	Scalar get_dt() const { return dt; }
+	const LevelData &get_data() const { return *data; }
+	const Player &get_player() const { return player; }
+	const Stats &get_stats() const { return stats; }
+	const std::optional<Vector2> &get_active_checkpoint() const { return active_checkpoint; }
+	// whether the player has reached the goal
+	bool is_completed() const { return completed; }
+	void count_restart() { ++stats.restarts; }
+
+	// the world position of the level's top left corner
+	Vector2 get_offset() const;
+	Vector2 get_player_spawn() const;
+
+	Snapshot snapshot() const;
+	void restore(const Snapshot &snapshot);
+	// a hash of the simulation's state, which is cheap enough to compute on
+	// every tick; two runs whose hashes differ on some tick have diverged
+	uint64_t state_hash() const;
+
+	// used by the player while it is updated
+
+	Rect get_collider(Scalar x, Scalar y) const;
+	// writes the merged colliders of the tiles containing the world space
+	// points between from and to (inclusive) to out, clipped to those
+	// tiles, and returns how many there are (at most cap, and at most
+	// MAX_COLLIDERS)
+	size_t get_colliders(Vec2 from, Vec2 to, Collider *out, size_t cap) const;
+	Tile get_tile(Scalar x, Scalar y) const;
+	void activate_checkpoint(Scalar x, Scalar y);
+	void respawn_player();
+	void complete();
+};
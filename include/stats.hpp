@@ -1,5 +1,7 @@
 #pragma once
 
+#include <cstddef>
+#include <iosfwd>
 #include <string>
 #include <unordered_map>
 
@@ -45,15 +47,25 @@ struct Stats {
 	}
 };
 
+// writes a time in ticks as seconds with hundredths (eg. "12.34"), which
+// reads the same whatever the tick rate; returns what snprintf does
+int format_time(char *buf, size_t size, unsigned ticks);
+
+// the key the personal best of the given name (a level number, or the
+// challenge run) is kept under: times at different tick rates can't be
+// compared, so those not at the default rate are kept apart
+std::string pb_key(const std::string &name);
+
 class PBFile {
 	std::unordered_map<std::string, Stats> pbs{};
-
-	static PBFile load(std::istream &inp);
-	void save(std::ostream &out) const;
 public:
+	// from/to the personal bests file in the data folder
 	static PBFile load();
 	void save() const;
 
+	static PBFile load(std::istream &inp);
+	void save(std::ostream &out) const;
+
 	bool has_pb(std::string key) const;
 	const Stats *get(std::string key) const;
 	void set(std::string key, Stats val);
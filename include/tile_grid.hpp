@@ -0,0 +1,133 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#include "raylib.h"
+
+/*
+ * tile definitions, and a compact 2D grid of tiles used to store levels
+ */
+
+enum class TileType { Empty, Solid, Danger, Goal, Checkpoint };
+
+struct Tile {
+	struct Bounce {
+		float top = 0;
+		float bottom = 0;
+		float side = 0;
+	};
+
+	constexpr Tile() : type(TileType::Empty), color(Color { 0, 0, 0, 0 }), in_front(false) {}
+	constexpr Tile(Color color) : type(TileType::Solid), color(color), in_front(false) {}
+	constexpr Tile(Color color, TileType type) : type(type), color(color), in_front(false) {}
+	constexpr Tile(Color color, TileType type, bool in_front) : type(type), color(color), in_front(in_front) {}
+	constexpr Tile(Color color, TileType type, bool in_front, Bounce bounce, float friction) : type(type), color(color), in_front(in_front), bounce(bounce), friction(friction) {}
+
+	TileType type;
+	Color color;
+	bool in_front;
+	Bounce bounce;
+	float friction = 12;
+
+	constexpr bool operator==(const Tile &other) const {
+		return type == other.type
+			&& color.r == other.color.r && color.g == other.color.g
+			&& color.b == other.color.b && color.a == other.color.a
+			&& in_front == other.in_front
+			&& bounce.top == other.bounce.top
+			&& bounce.bottom == other.bounce.bottom
+			&& bounce.side == other.bounce.side
+			&& friction == other.friction;
+	}
+	constexpr bool operator!=(const Tile &other) const {
+		return !(*this == other);
+	}
+};
+
+// A level only ever uses a handful of distinct tiles, so rather than storing a
+// full Tile (~28 bytes) for every cell, the grid stores a single byte per cell
+// which indexes into a small per-level palette of tiles.
+// Palette entry 0 is always the empty (air) tile, so that a zeroed cell is air.
+//
+// Furthermore, levels are mostly air, so the cells are split up into square
+// chunks, and chunks containing only air are never allocated; instead they all
+// point to a single shared empty chunk. This way memory use scales with the
+// occupied area of the level rather than its total size.
+class TileGrid {
+public:
+	using index_t = uint8_t;
+	static constexpr size_t MAX_PALETTE = 256;
+
+	static constexpr int CHUNK_BITS = 5;
+	static constexpr int CHUNK_SIZE = 1 << CHUNK_BITS; // 32x32 cells
+	static constexpr int CHUNK_MASK = CHUNK_SIZE - 1;
+	struct Chunk {
+		index_t cells[CHUNK_SIZE*CHUNK_SIZE];
+	};
+
+private:
+	static const Chunk empty_chunk;
+
+	std::vector<Tile> palette;
+	// every entry points either to empty_chunk, to the chunk owned in the
+	// same slot of owned_chunks, or to a chunk borrowed from backing
+	std::vector<const Chunk *> chunks;
+	std::vector<std::unique_ptr<Chunk>> owned_chunks;
+	// keeps borrowed chunks (eg. in a memory mapped file) alive
+	std::shared_ptr<const void> backing;
+	int w, h;
+	int chunks_w, chunks_h;
+
+	size_t chunk_ix(int cx, int cy) const {
+		return size_t(cy)*size_t(chunks_w) + size_t(cx);
+	}
+
+public:
+	TileGrid();
+	// creates a grid filled with air (palette entry 0)
+	TileGrid(std::vector<Tile> palette, int w, int h);
+	// same as above, but chunks can be borrowed from memory kept alive by
+	// backing with set_chunk
+	TileGrid(std::vector<Tile> palette, int w, int h, std::shared_ptr<const void> backing);
+	// builds the palette from the distinct tiles in the given w*h array
+	TileGrid(const Tile *tiles, int w, int h);
+
+	TileGrid(TileGrid&&) = default;
+	TileGrid &operator=(TileGrid&&) = default;
+
+	int width() const { return w; }
+	int height() const { return h; }
+	bool in_bounds(int x, int y) const {
+		return x >= 0 && x < w && y >= 0 && y < h;
+	}
+
+	// these do no bounds checking, use in_bounds first
+	index_t index_at(int x, int y) const {
+		const Chunk *chunk = chunks[chunk_ix(x >> CHUNK_BITS, y >> CHUNK_BITS)];
+		return chunk->cells[((y & CHUNK_MASK) << CHUNK_BITS) | (x & CHUNK_MASK)];
+	}
+	const Tile &at(int x, int y) const { return palette[index_at(x, y)]; }
+	// allocates the containing chunk if it is still the shared empty chunk
+	// (or copies it if it is borrowed); safe to call concurrently as long as
+	// the calls touch different chunks
+	void set(int x, int y, index_t ix);
+	// uses the given chunk in place without copying it; it must stay alive
+	// for as long as the grid's backing does
+	void set_chunk(int cx, int cy, const Chunk *chunk);
+
+	int chunks_width() const { return chunks_w; }
+	int chunks_height() const { return chunks_h; }
+	bool chunk_empty(int cx, int cy) const {
+		return chunks[chunk_ix(cx, cy)] == &empty_chunk;
+	}
+	// cells of the chunk, CHUNK_SIZE rows of CHUNK_SIZE cells each
+	const index_t *chunk_cells(int cx, int cy) const {
+		return chunks[chunk_ix(cx, cy)]->cells;
+	}
+
+	const std::vector<Tile> &get_palette() const { return palette; }
+	size_t memory_usage() const;
+};
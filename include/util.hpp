@@ -1,5 +1,8 @@
 #pragma once
 
+#include <cstddef>
+#include <cstdint>
+
 #include "raylib.h"
 
 namespace util {
@@ -8,13 +11,67 @@ namespace util {
  * collision detection & resolution helper
  */
 
-struct Collision {
-	Vector2 dist = { 0, 0 }; // how the first object needs to be moved to no longer overlap
-	Vector2 new_pos = { 0, 0 }; // where the first object needs to be moved to to no longer overlap
+// raylib's Vector2 and Rectangle, for any number type (eg. util::Fixed, see
+// fixed.hpp)
+template<typename T>
+struct BasicVector2 {
+	T x, y;
+};
+template<typename T>
+struct BasicRectangle {
+	T x, y, width, height;
+};
+
+template<typename T>
+struct BasicCollision {
+	BasicVector2<T> dist = { 0, 0 }; // how the first object needs to be moved to no longer overlap
+	BasicVector2<T> new_pos = { 0, 0 }; // where the first object needs to be moved to to no longer overlap
 	bool x_touches = 0; // does 0 mean x is touching, or x is not colliding at all?
 	bool y_touches = 0; // does 0 mean y is touching, or y is not colliding at all?
 };
+using Collision = BasicCollision<float>;
+
+// implemented for float and util::Fixed
+template<typename T>
+BasicCollision<T> collide(BasicRectangle<T> from, BasicRectangle<T> to);
+inline Collision collide(Rectangle from, Rectangle to) {
+	return collide<float>(
+		{ from.x, from.y, from.width, from.height },
+		{ to.x, to.y, to.width, to.height }
+	);
+}
+
+// a number of rectangles stored component by component (as a structure of
+// arrays), so that several of them can be loaded into SIMD registers at once
+struct RectangleBatch {
+	const float *x, *y, *width, *height;
+	size_t count;
+};
+
+// collides `from` with every rectangle in `to`, writing the results to `out`
+// (which must have room for to.count collisions); the results are exactly
+// the same as those of calling collide on each of the rectangles, only
+// several rectangles are done at once where SSE or AVX is available
+void collide_batch(Rectangle from, const RectangleBatch &to, Collision *out);
 
-Collision collide(Rectangle from, Rectangle to);
+/*
+ * streaming 64-bit FNV-1a hash, for hashing plain data
+ */
+
+struct Hash {
+	uint64_t value = 0xcbf29ce484222325ull;
+
+	void add_bytes(const void *data, size_t len);
+	// only use with types without padding, the padding bytes are undefined
+	template<typename T>
+	void add(const T &item) { add_bytes(&item, sizeof(item)); }
+	// mixes in a whole word at once rather than byte by byte, which is a lot
+	// faster for hashing many small values (such as the simulation state on
+	// every tick)
+	void add_word(uint64_t word) {
+		value ^= word * 0x9e3779b97f4a7c15ull;
+		value = (value << 31 | value >> 33) * 0x100000001b3ull;
+	}
+};
 
 }
@@ -15,6 +15,9 @@ void usage(FILE *stream) {
 	fprintf(stream, "    clean             deletes all build files\n");
 	fprintf(stream, "    init              generates config.h, if it does not exist\n");
 	fprintf(stream, "    run               run the executable after it has been built\n");
+	fprintf(stream, "    bench             run the benchmarks after building, comparing against the baseline\n");
+	fprintf(stream, "    check             run the checking tools after building, failing if any check fails\n");
+	fprintf(stream, "    check-allocs      play every level without a window after building, failing if a frame allocates\n");
 	fprintf(stream, "    help, --help, -h  displays this help message and exits\n");
 }
 
@@ -93,7 +96,11 @@ const char *initial_config =
 	"// #define RELEASE // Enable release build"nl
 	"// #define ENABLE_PROFILER // Enable C++'s built-in profiler (for development)"nl
 	"// #define ENABLE_MEMORY_SANITIZER // Enable C++'s built-in memory sanitizer (for development)"nl
+	"// #define ENABLE_THREAD_SANITIZER // Enable C++'s built-in thread sanitizer, eg. for ./nob check (for development, not together with the memory sanitizer)"nl
 	"// #define WINDOWS // Cross-compile for windows"nl
+	"// #define FLOAT_PHYSICS // Use floats rather than fixed point numbers for the physics (replays won't carry over between builds)"nl
+	"// #define ENABLE_AVX // Compile for CPUs with AVX, eg. so that ./nob check covers the batched collision's AVX path too"nl
+	"// #define PHYSICS_TICK_RATE 120 // Run the physics at this many ticks per second rather than 32 (personal bests and replays are kept apart per rate)"nl
 	"#define WAYLAND // Enable wayland build"nl
 	"// NOTE: for some reason, fullscreen doesn't work when running the X11"nl
 	"// build in sway; I suspect it is some issue with Xwayland, but"nl
@@ -15,14 +15,13 @@ void ActionOnce::register_key(KeyboardKey key, bool on_press) const {
 	}
 }
 ActionOnce::cb_handle_t ActionOnce::register_cb(ActionOnce::cb_t callback) {
-	callbacks[id_counter] = callback;
-	return { callbacks, id_counter++ };
+	return callbacks.add(callback);
 }
 
 void ActionOnce::trigger() const {
-	for (auto &cb : callbacks) {
-		cb.second();
-	}
+	callbacks.for_each([](const cb_t &cb) {
+		cb();
+	});
 }
 
 ActionStartStop::ActionStartStop() { }
@@ -35,19 +34,20 @@ void ActionStartStop::register_key(KeyboardKey key) {
 ActionStartStop::cb_handle_t ActionStartStop::register_cb(
 	ActionStartStop::cb_t on_start, ActionStartStop::cb_t on_end
 ) {
-	callbacks[id_counter] = std::make_pair(on_start, on_end);
-	return { callbacks, id_counter++ };
+	return callbacks.add(std::make_pair(on_start, on_end));
 }
 
 void ActionStartStop::press() {
-	for (auto &cb : callbacks) {
-		cb.second.first();
-	}
+	if (keys_down++ > 0) return;
+	callbacks.for_each([](const dbl_cb_t &cb) {
+		cb.first();
+	});
 }
 void ActionStartStop::release() {
-	for (auto &cb : callbacks) {
-		cb.second.second();
-	}
+	if (keys_down == 0 || --keys_down > 0) return;
+	callbacks.for_each([](const dbl_cb_t &cb) {
+		cb.second();
+	});
 }
 
 ActionSustain::ActionSustain() { }
@@ -55,30 +55,33 @@ void ActionSustain::register_key(KeyboardKey key) const {
 	InputManager::get().registerSustain(key, [this](float dt) { this->trigger(dt); });
 }
 ActionSustain::cb_handle_t ActionSustain::register_cb(ActionSustain::cb_t callback) {
-	callbacks[id_counter] = callback;
-	return { callbacks, id_counter++ };
+	return callbacks.add(callback);
 }
 
 void ActionSustain::trigger(float dt) const {
-	for (auto &cb : callbacks) {
-		cb.second(dt);
-	}
+	callbacks.for_each([dt](const cb_t &cb) {
+		cb(dt);
+	});
 }
 
 namespace Action {
 
-ActionSustain Jump{};
+ActionStartStop Jump{};
 ActionOnce DoubleJump{};
-ActionSustain Slam{};
-ActionSustain Left{};
-ActionSustain Right{};
+ActionStartStop Slam{};
+ActionStartStop Left{};
+ActionStartStop Right{};
 #ifdef DEBUG
-ActionSustain Fly{};
+ActionStartStop Fly{};
+ActionOnce ExportTrace{};
+ActionOnce SlowDown{};
+ActionOnce SpeedUp{};
 #endif
 
 ActionOnce Suicide{};
 ActionOnce Reset{};
 ActionOnce Pause{};
 ActionOnce NextLevel{};
+ActionOnce TogglePerfHud{};
 
 }
@@ -0,0 +1,24 @@
+#include "alloc_counter.hpp"
+
+#include <atomic>
+#include <cstdint>
+#include <cstdlib>
+#include <new>
+
+std::atomic<uint64_t> alloc_counter::allocations = 0;
+
+// the array versions call these, so they are counted as well
+//
+// none of these are inlined, as gcc otherwise warns about mismatched
+// malloc/delete and operator new/free pairs
+[[gnu::noinline]] void *operator new(size_t size) {
+	alloc_counter::allocations.fetch_add(1, std::memory_order_relaxed);
+	if (void *res = std::malloc(size ? size : 1)) return res;
+	throw std::bad_alloc();
+}
+[[gnu::noinline]] void operator delete(void *ptr) noexcept {
+	std::free(ptr);
+}
+[[gnu::noinline]] void operator delete(void *ptr, size_t) noexcept {
+	std::free(ptr);
+}
@@ -0,0 +1,95 @@
+#include "chunk_renderer.hpp"
+
+#include <algorithm>
+#include <cstddef>
+
+#include "raylib.h"
+
+#include "tile_grid.hpp"
+
+ChunkRenderer::ChunkRenderer(const TileGrid &tiles)
+: chunks(size_t(tiles.chunks_width())*size_t(tiles.chunks_height())),
+  chunks_w(tiles.chunks_width()), chunks_h(tiles.chunks_height())
+{
+	for (int cy = 0; cy < chunks_h; ++cy) {
+		for (int cx = 0; cx < chunks_w; ++cx) {
+			if (!tiles.chunk_empty(cx, cy)) ++unbaked;
+		}
+	}
+	if (unbaked <= MAX_BAKED_UP_FRONT) {
+		bake_area(tiles, 0, 0, chunks_w - 1, chunks_h - 1, unbaked);
+	}
+}
+
+ChunkRenderer::~ChunkRenderer() {
+	// the textures are freed along with the graphics context if the window
+	// has been closed already
+	if (!IsWindowReady()) return;
+
+	for (const auto &chunk : chunks) {
+		if (chunk.layers.back.id != 0) UnloadTexture(chunk.layers.back);
+		if (chunk.layers.front.id != 0) UnloadTexture(chunk.layers.front);
+	}
+}
+
+size_t ChunkRenderer::bake_area(const TileGrid &tiles, int cx0, int cy0, int cx1, int cy1, size_t budget) {
+	if (unbaked == 0 || !IsWindowReady()) return 0;
+
+	cx0 = std::max(cx0, 0);
+	cy0 = std::max(cy0, 0);
+	cx1 = std::min(cx1, chunks_w - 1);
+	cy1 = std::min(cy1, chunks_h - 1);
+
+	size_t baked = 0;
+	for (int cy = cy0; cy <= cy1; ++cy) {
+		for (int cx = cx0; cx <= cx1; ++cx) {
+			if (baked == budget) return baked;
+			if (chunks[size_t(cx) + size_t(cy)*chunks_w].baked) continue;
+			if (tiles.chunk_empty(cx, cy)) continue;
+
+			bake(tiles, cx, cy);
+			++baked;
+		}
+	}
+	return baked;
+}
+
+void ChunkRenderer::bake(const TileGrid &tiles, int cx, int cy) {
+	Entry &chunk = chunks[size_t(cx) + size_t(cy)*chunks_w];
+	chunk.baked = true;
+	--unbaked;
+
+	Image back = GenImageColor(TileGrid::CHUNK_SIZE, TileGrid::CHUNK_SIZE, BLANK);
+	Image front = GenImageColor(TileGrid::CHUNK_SIZE, TileGrid::CHUNK_SIZE, BLANK);
+	auto *back_pixels = static_cast<Color *>(back.data);
+	auto *front_pixels = static_cast<Color *>(front.data);
+	bool has_back = false, has_front = false;
+
+	// the cells outside of the level in chunks on its edges are air, so
+	// the whole chunk can be baked as-is
+	const auto &palette = tiles.get_palette();
+	const TileGrid::index_t *cells = tiles.chunk_cells(cx, cy);
+	for (int i = 0; i < TileGrid::CHUNK_SIZE*TileGrid::CHUNK_SIZE; ++i) {
+		const Tile &tile = palette[cells[i]];
+		if (tile.color.a == 0) continue;
+
+		if (tile.in_front) {
+			front_pixels[i] = tile.color;
+			has_front = true;
+		} else {
+			back_pixels[i] = tile.color;
+			has_back = true;
+		}
+	}
+
+	if (has_back) {
+		chunk.layers.back = LoadTextureFromImage(back);
+		SetTextureFilter(chunk.layers.back, TEXTURE_FILTER_POINT);
+	}
+	if (has_front) {
+		chunk.layers.front = LoadTextureFromImage(front);
+		SetTextureFilter(chunk.layers.front, TEXTURE_FILTER_POINT);
+	}
+	UnloadImage(back);
+	UnloadImage(front);
+}
@@ -0,0 +1,145 @@
+#include "collider_mesh.hpp"
+
+#include <algorithm>
+#include <vector>
+
+#include "tile_grid.hpp"
+
+ColliderMesh::ColliderMesh(const TileGrid &tiles, bool merge)
+: w(tiles.width()), h(tiles.height()),
+  buckets_w((w + (1 << BUCKET_BITS) - 1) >> BUCKET_BITS),
+  buckets_h((h + (1 << BUCKET_BITS) - 1) >> BUCKET_BITS)
+{
+	const auto &palette = tiles.get_palette();
+
+	// tiles only need to behave the same to be merged, so every palette
+	// entry is mapped to the first entry which behaves the same as it
+	std::vector<TileGrid::index_t> class_of(palette.size());
+	for (size_t i = 0; i < palette.size(); ++i) {
+		size_t j = 0;
+		while (
+			palette[j].type != palette[i].type
+			|| palette[j].bounce.top != palette[i].bounce.top
+			|| palette[j].bounce.bottom != palette[i].bounce.bottom
+			|| palette[j].bounce.side != palette[i].bounce.side
+			|| palette[j].friction != palette[i].friction
+		) ++j;
+		class_of[i] = j;
+	}
+
+	// greedy meshing: take the first cell not yet covered (row by row),
+	// extend it to the right as far as possible, and then extend that run
+	// downwards as far as possible
+	std::vector<bool> covered(size_t(w)*size_t(h), false);
+	const auto mergeable = [&](int x, int y, TileGrid::index_t cls) {
+		return !covered[size_t(x) + size_t(y)*w]
+			&& class_of[tiles.index_at(x, y)] == cls;
+	};
+	for (int y = 0; y < h; ++y) {
+		int x = 0;
+		while (x < w) {
+			if (tiles.chunk_empty(x >> TileGrid::CHUNK_BITS, y >> TileGrid::CHUNK_BITS)) {
+				x = (x | TileGrid::CHUNK_MASK) + 1;
+				continue;
+			}
+
+			const TileGrid::index_t ix = tiles.index_at(x, y);
+			const TileType type = palette[ix].type;
+			if (type == TileType::Empty || covered[size_t(x) + size_t(y)*w]) {
+				++x;
+				continue;
+			}
+
+			const TileGrid::index_t cls = class_of[ix];
+			int rw = 1, rh = 1;
+			if (merge && type != TileType::Checkpoint) {
+				while (x + rw < w && mergeable(x + rw, y, cls)) ++rw;
+				while (y + rh < h) {
+					bool row_matches = true;
+					for (int dx = 0; dx < rw && row_matches; ++dx) {
+						row_matches = mergeable(x + dx, y + rh, cls);
+					}
+					if (!row_matches) break;
+					++rh;
+				}
+			}
+
+			for (int dy = 0; dy < rh; ++dy) {
+				for (int dx = 0; dx < rw; ++dx) {
+					covered[size_t(x + dx) + size_t(y + dy)*w] = true;
+				}
+			}
+			colliders.push_back({ x, y, rw, rh, ix });
+			x += rw;
+		}
+	}
+
+	// bucket the colliders (counting sort), keeping them in the order they
+	// were created within each bucket
+	const size_t bucket_count = size_t(buckets_w)*size_t(buckets_h);
+	bucket_start.assign(bucket_count + 1, 0);
+	const auto for_each_bucket = [this](const Collider &c, auto f) {
+		for (int by = c.y >> BUCKET_BITS; by <= (c.y + c.h - 1) >> BUCKET_BITS; ++by) {
+			for (int bx = c.x >> BUCKET_BITS; bx <= (c.x + c.w - 1) >> BUCKET_BITS; ++bx) {
+				f(size_t(bx) + size_t(by)*buckets_w);
+			}
+		}
+	};
+	for (const auto &c : colliders) {
+		for_each_bucket(c, [this](size_t bucket) { ++bucket_start[bucket + 1]; });
+	}
+	for (size_t i = 0; i < bucket_count; ++i) {
+		bucket_start[i + 1] += bucket_start[i];
+	}
+	bucket_items.resize(bucket_start[bucket_count]);
+	std::vector<uint32_t> fill(bucket_start.begin(), bucket_start.end() - 1);
+	for (uint32_t id = 0; id < colliders.size(); ++id) {
+		for_each_bucket(colliders[id], [&](size_t bucket) {
+			bucket_items[fill[bucket]++] = id;
+		});
+	}
+}
+
+size_t ColliderMesh::query(int x0, int y0, int x1, int y1, Collider *out, size_t cap) const {
+	x0 = std::max(x0, 0);
+	y0 = std::max(y0, 0);
+	x1 = std::min(x1, w - 1);
+	y1 = std::min(y1, h - 1);
+	if (x0 > x1 || y0 > y1) return 0;
+
+	size_t n = 0;
+	for (int by = y0 >> BUCKET_BITS; by <= y1 >> BUCKET_BITS; ++by) {
+		for (int bx = x0 >> BUCKET_BITS; bx <= x1 >> BUCKET_BITS; ++bx) {
+			const size_t bucket = size_t(bx) + size_t(by)*buckets_w;
+			for (uint32_t i = bucket_start[bucket]; i < bucket_start[bucket + 1]; ++i) {
+				const Collider &c = colliders[bucket_items[i]];
+				const int cx0 = std::max(c.x, x0);
+				const int cy0 = std::max(c.y, y0);
+				const int cx1 = std::min(c.x + c.w - 1, x1);
+				const int cy1 = std::min(c.y + c.h - 1, y1);
+				if (cx0 > cx1 || cy0 > cy1) continue;
+				// a collider spanning several buckets is only
+				// reported by the bucket containing its clipped
+				// top left corner, so it is reported only once
+				if (cx0 >> BUCKET_BITS != bx || cy0 >> BUCKET_BITS != by) continue;
+				if (n == cap) return n;
+
+				// insertion sort, there are only ever a handful
+				size_t j = n++;
+				while (j > 0 && (out[j-1].y > cy0 || (out[j-1].y == cy0 && out[j-1].x > cx0))) {
+					out[j] = out[j-1];
+					--j;
+				}
+				out[j] = { cx0, cy0, cx1 - cx0 + 1, cy1 - cy0 + 1, c.tile };
+			}
+		}
+	}
+	return n;
+}
+
+size_t ColliderMesh::memory_usage() const {
+	return sizeof(*this)
+		+ colliders.capacity() * sizeof(Collider)
+		+ bucket_start.capacity() * sizeof(uint32_t)
+		+ bucket_items.capacity() * sizeof(uint32_t);
+}
@@ -32,6 +32,7 @@ template<typename T>
 static std::optional<T> parse(std::string str);
 #define PARSER(type) template<> std::optional<type> parse(std::string str)
 PARSER(int);
+PARSER(bool);
 PARSER(WindowState);
 
 Config Config::read(std::istream &stream) {
@@ -92,6 +93,7 @@ template<typename T>
 static std::string unparse(T &val);
 #define WRITER(type) template<> std::string unparse(const type &val)
 WRITER(int);
+WRITER(bool);
 WRITER(WindowState);
 
 void Config::write(std::ostream &stream) const {
@@ -108,6 +110,12 @@ PARSER(int) {
 	// integers are handled simply
 	return std::stoi(str);
 }
+PARSER(bool) {
+	// booleans are one of two words
+	if (str == "true") return true;
+	if (str == "false") return false;
+	return {};
+}
 PARSER(WindowState) {
 	// window states are looked up in the window state array
 	for (size_t i = 0; i < sizeof(windowstate_strmap)/sizeof(*windowstate_strmap); ++i) {
@@ -121,6 +129,9 @@ WRITER(int) {
 	// integers are stringified simply
 	return std::to_string(val);
 }
+WRITER(bool) {
+	return val ? "true" : "false";
+}
 WRITER(WindowState) {
 	// window states are looked up in the window state array
 	for (size_t i = 0; i < sizeof(windowstate_strmap)/sizeof(*windowstate_strmap); ++i) {
@@ -0,0 +1,254 @@
+#include "cooked_level.hpp"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <optional>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "level_data.hpp"
+#include "mapped_file.hpp"
+#include "tile_grid.hpp"
+
+static constexpr uint64_t CHUNK_ALIGN = 64;
+
+static uint64_t align_up(uint64_t n, uint64_t align) {
+	return (n + align - 1) / align * align;
+}
+
+std::string CookedLevel::path_for(const std::string &image_path) {
+	const auto dot = image_path.find_last_of('.');
+	const auto slash = image_path.find_last_of('/');
+	if (dot == std::string::npos || (slash != std::string::npos && dot < slash)) {
+		return image_path + ".lvl";
+	}
+	return image_path.substr(0, dot) + ".lvl";
+}
+
+// every cell of a chunk must index into the palette, as the grid looks tiles
+// up without checking; with a full palette every index is valid anyway
+static bool cells_valid(const TileGrid::Chunk &chunk, uint32_t palette_len) {
+	if (palette_len >= TileGrid::MAX_PALETTE) return true;
+	TileGrid::index_t max = 0;
+	for (const auto cell : chunk.cells) max = std::max(max, cell);
+	return max < palette_len;
+}
+
+std::optional<LevelData> CookedLevel::load(const std::string &path) {
+	const auto file = MappedFile::open(path.c_str());
+	if (file == nullptr) return {};
+
+	const unsigned char *data = file->data();
+	const size_t size = file->size();
+
+	// check that a region of the file is actually inside of the file
+	const auto in_file = [size](uint64_t offset, uint64_t len) {
+		return offset <= size && len <= size - offset;
+	};
+
+	Header header;
+	if (!in_file(0, sizeof(header))) {
+		std::cerr << "WARN: cooked level " << path << " is truncated" << std::endl;
+		return {};
+	}
+	std::memcpy(&header, data, sizeof(header));
+	if (std::memcmp(header.magic, MAGIC, sizeof(MAGIC)) != 0) {
+		std::cerr << "WARN: " << path << " is not a cooked level" << std::endl;
+		return {};
+	}
+	if (header.version != VERSION) {
+		std::cerr << "WARN: cooked level " << path << " has version " << header.version << ", expected " << VERSION << std::endl;
+		return {};
+	}
+
+	if (!LevelData::check_size(path, header.w, header.h)) return {};
+
+	const uint64_t chunks_w = (uint64_t(header.w) + TileGrid::CHUNK_MASK) >> TileGrid::CHUNK_BITS;
+	const uint64_t chunks_h = (uint64_t(header.h) + TileGrid::CHUNK_MASK) >> TileGrid::CHUNK_BITS;
+	const bool valid = header.palette_len > 0
+		&& header.palette_len <= TileGrid::MAX_PALETTE
+		&& in_file(header.palette_offset, uint64_t(header.palette_len)*sizeof(PaletteEntry))
+		&& in_file(header.chunk_table_offset, chunks_w*chunks_h*sizeof(uint32_t))
+		&& in_file(header.chunk_data_offset, uint64_t(header.filled_chunks)*sizeof(TileGrid::Chunk))
+		&& header.text_offset <= size;
+	if (!valid) {
+		std::cerr << "WARN: cooked level " << path << " is corrupt" << std::endl;
+		return {};
+	}
+
+	std::vector<Tile> palette;
+	palette.reserve(header.palette_len);
+	for (uint32_t i = 0; i < header.palette_len; ++i) {
+		PaletteEntry entry;
+		std::memcpy(&entry, data + header.palette_offset + i*sizeof(entry), sizeof(entry));
+		if (entry.type > uint8_t(TileType::Checkpoint)) {
+			std::cerr << "WARN: cooked level " << path << " is corrupt" << std::endl;
+			return {};
+		}
+		palette.push_back(Tile(
+			{ entry.r, entry.g, entry.b, entry.a },
+			TileType(entry.type), entry.in_front,
+			{ entry.bounce_top, entry.bounce_bottom, entry.bounce_side },
+			entry.friction
+		));
+	}
+	// the grid relies on entry zero being air, eg. for its empty chunks
+	if (palette[0] != Tile()) {
+		std::cerr << "WARN: cooked level " << path << " is corrupt" << std::endl;
+		return {};
+	}
+
+	TileGrid tiles(std::move(palette), header.w, header.h, file);
+
+	// the chunks are used straight from the mapped file, without copying
+	const auto *chunk_data = reinterpret_cast<const TileGrid::Chunk *>(
+		data + header.chunk_data_offset
+	);
+	for (uint64_t cy = 0; cy < chunks_h; ++cy) {
+		for (uint64_t cx = 0; cx < chunks_w; ++cx) {
+			uint32_t chunk;
+			std::memcpy(
+				&chunk,
+				data + header.chunk_table_offset + (cx + cy*chunks_w)*sizeof(chunk),
+				sizeof(chunk)
+			);
+			if (chunk == 0) continue;
+			if (chunk > header.filled_chunks || !cells_valid(chunk_data[chunk - 1], header.palette_len)) {
+				std::cerr << "WARN: cooked level " << path << " is corrupt" << std::endl;
+				return {};
+			}
+			tiles.set_chunk(cx, cy, &chunk_data[chunk - 1]);
+		}
+	}
+
+	std::vector<LevelText> texts;
+	uint64_t text_pos = header.text_offset;
+	for (uint32_t i = 0; i < header.text_count; ++i) {
+		TextEntry entry;
+		if (!in_file(text_pos, sizeof(entry))) {
+			std::cerr << "WARN: cooked level " << path << " is corrupt" << std::endl;
+			return {};
+		}
+		std::memcpy(&entry, data + text_pos, sizeof(entry));
+		text_pos += sizeof(entry);
+		if (!in_file(text_pos, entry.len)) {
+			std::cerr << "WARN: cooked level " << path << " is corrupt" << std::endl;
+			return {};
+		}
+
+		texts.push_back({
+			std::string(reinterpret_cast<const char *>(data + text_pos), entry.len),
+			{ entry.r, entry.g, entry.b, entry.a },
+			{ entry.x, entry.y },
+		});
+		text_pos += align_up(entry.len, 4);
+	}
+
+	return LevelData(
+		std::move(tiles), { header.spawn_x, header.spawn_y },
+		std::move(texts)
+	);
+}
+
+bool CookedLevel::save(const std::string &path, const LevelData &level) {
+	const auto &tiles = level.tiles;
+	const auto &texts = level.texts;
+	const auto &palette = tiles.get_palette();
+	const uint64_t chunk_count = uint64_t(tiles.chunks_width())*tiles.chunks_height();
+
+	// only chunks containing something other than air are stored
+	std::vector<uint32_t> chunk_table(chunk_count, 0);
+	std::vector<const TileGrid::index_t *> filled;
+	for (int cy = 0; cy < tiles.chunks_height(); ++cy) {
+		for (int cx = 0; cx < tiles.chunks_width(); ++cx) {
+			if (tiles.chunk_empty(cx, cy)) continue;
+			filled.push_back(tiles.chunk_cells(cx, cy));
+			chunk_table[uint64_t(cx) + uint64_t(cy)*tiles.chunks_width()] = filled.size();
+		}
+	}
+
+	// zero the padding bytes too, so that cooking is reproducible
+	Header header;
+	std::memset(&header, 0, sizeof(header));
+	std::memcpy(header.magic, MAGIC, sizeof(MAGIC));
+	header.version = VERSION;
+	header.w = tiles.width();
+	header.h = tiles.height();
+	header.spawn_x = level.spawn.x;
+	header.spawn_y = level.spawn.y;
+	header.palette_len = palette.size();
+	header.filled_chunks = filled.size();
+	header.text_count = texts.size();
+	header.palette_offset = sizeof(Header);
+	header.chunk_table_offset = header.palette_offset + palette.size()*sizeof(PaletteEntry);
+	header.chunk_data_offset = align_up(
+		header.chunk_table_offset + chunk_count*sizeof(uint32_t),
+		CHUNK_ALIGN
+	);
+	header.text_offset = header.chunk_data_offset + filled.size()*sizeof(TileGrid::Chunk);
+
+	// the game may have the old file mapped, so it is written to a temporary
+	// file first and renamed over it; the mapping keeps the old contents
+	// rather than the file being truncated from under it
+	const std::string tmp_path = path + ".tmp";
+	std::ofstream out(tmp_path, std::ios::binary);
+	if (!out) {
+		std::cerr << "Failed opening " << tmp_path << " for writing!" << std::endl;
+		return false;
+	}
+
+	const auto write = [&out](const void *data, uint64_t len) {
+		out.write(static_cast<const char *>(data), len);
+	};
+	const auto pad_to = [&out](uint64_t pos) {
+		while (uint64_t(out.tellp()) < pos) out.put('\0');
+	};
+
+	write(&header, sizeof(header));
+	for (const auto &tile : palette) {
+		const PaletteEntry entry = {
+			uint8_t(tile.type), tile.in_front,
+			tile.color.r, tile.color.g, tile.color.b, tile.color.a,
+			{ 0, 0 },
+			tile.bounce.top, tile.bounce.bottom, tile.bounce.side,
+			tile.friction,
+		};
+		write(&entry, sizeof(entry));
+	}
+	write(chunk_table.data(), chunk_table.size()*sizeof(uint32_t));
+	pad_to(header.chunk_data_offset);
+	for (const auto *cells : filled) {
+		write(cells, sizeof(TileGrid::Chunk));
+	}
+	for (const auto &text : texts) {
+		const TextEntry entry = {
+			text.color.r, text.color.g, text.color.b, text.color.a,
+			text.pos.x, text.pos.y, uint32_t(text.text.size()),
+		};
+		write(&entry, sizeof(entry));
+		write(text.text.data(), text.text.size());
+		pad_to(align_up(out.tellp(), 4));
+	}
+
+	out.close();
+	if (!out) {
+		std::cerr << "Failed writing " << tmp_path << "!" << std::endl;
+		std::remove(tmp_path.c_str());
+		return false;
+	}
+
+	std::error_code err;
+	std::filesystem::rename(tmp_path, path, err);
+	if (err) {
+		std::cerr << "Failed renaming " << tmp_path << " to " << path << ": " << err.message() << std::endl;
+		std::remove(tmp_path.c_str());
+		return false;
+	}
+	return true;
+}
@@ -0,0 +1,36 @@
+#include "fixed_step.hpp"
+
+#include <cmath>
+
+FixedStepScheduler::FixedStepScheduler(int tick_rate, uint32_t max_ticks_per_frame)
+: tick_rate(tick_rate), max_ticks(max_ticks_per_frame) { }
+
+void FixedStepScheduler::set_time_scale(double scale) {
+	// a negative (or NaN) scale would make the accumulator go backwards
+	time_scale = scale > 0 ? scale : 0;
+}
+
+uint64_t FixedStepScheduler::take_due() {
+	uint64_t due = accumulated >> FRACTION_BITS;
+	accumulated &= ONE_TICK - 1;
+	if (max_ticks != UNLIMITED && due > max_ticks) {
+		dropped += due - max_ticks;
+		due = max_ticks;
+	}
+	return due;
+}
+
+uint64_t FixedStepScheduler::advance(double seconds) {
+	if (seconds > 0) {
+		accumulated += std::llround(std::ldexp(seconds * time_scale * tick_rate, FRACTION_BITS));
+	}
+	return take_due();
+}
+uint64_t FixedStepScheduler::advance_ticks(uint64_t ticks) {
+	accumulated += ticks << FRACTION_BITS;
+	return take_due();
+}
+
+float FixedStepScheduler::alpha() const {
+	return std::ldexp(float(accumulated), -FRACTION_BITS);
+}
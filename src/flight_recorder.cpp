@@ -0,0 +1,139 @@
+#include "flight_recorder.hpp"
+
+#include <algorithm>
+#include <ctime>
+#include <fstream>
+#include <iostream>
+#include <string>
+
+#include "alloc_counter.hpp"
+#include "config.hpp"
+#include "globals.hpp"
+
+FlightRecorder &FlightRecorder::get() {
+	static FlightRecorder instance;
+
+	return instance;
+}
+
+FlightRecorder::~FlightRecorder() {
+	if (!writer.joinable()) return;
+	{
+		const std::lock_guard<std::mutex> lock(dump_mutex);
+		stopping = true;
+	}
+	dump_cv.notify_one();
+	// a dump that is still pending is written before the thread exits
+	writer.join();
+}
+
+static float millis(std::chrono::steady_clock::duration d) {
+	return std::chrono::duration<float, std::milli>(d).count();
+}
+
+void FlightRecorder::begin_frame() {
+	frame_start = clock::now();
+	update_end = present_start = frame_start;
+	physics_ticks = 0;
+	draw_calls = 0;
+	rectangles = 0;
+	inputs = 0;
+	input_latency = 0;
+	allocations_at_start = alloc_counter::count();
+}
+void FlightRecorder::end_update() {
+	update_end = clock::now();
+}
+void FlightRecorder::begin_present() {
+	present_start = clock::now();
+}
+void FlightRecorder::end_frame() {
+	const auto frame_end = clock::now();
+
+	Frame &frame = frames[frame_nr & MASK];
+	frame.number = frame_nr;
+	frame.total = millis(frame_end - frame_start);
+	frame.update = millis(update_end - frame_start);
+	frame.draw = millis(present_start - update_end);
+	frame.present = millis(frame_end - present_start);
+	frame.physics_ticks = physics_ticks;
+	frame.draw_calls = draw_calls;
+	frame.rectangles = rectangles;
+	frame.allocations = alloc_counter::count() - allocations_at_start;
+	frame.inputs = inputs;
+	frame.input_latency = input_latency;
+
+	const int budget = global::config.hitch_budget_ms;
+	if (budget > 0 && frame.total > budget) dump();
+
+	++frame_nr;
+}
+
+void FlightRecorder::dump() {
+	if (dumps >= MAX_DUMPS) return;
+
+	std::unique_lock<std::mutex> lock(dump_mutex, std::try_to_lock);
+	// if the writer is still busy with the previous dump, the frames are
+	// left for the next one
+	if (!lock.owns_lock() || dump_pending) return;
+
+	if (dump_frames == nullptr) dump_frames = std::make_unique<Frame[]>(CAPACITY);
+	const uint64_t first = std::max(first_undumped, frame_nr + 1 > CAPACITY ? frame_nr + 1 - CAPACITY : 0);
+	dump_count = 0;
+	for (uint64_t i = first; i <= frame_nr; ++i) {
+		dump_frames[dump_count++] = frames[i & MASK];
+	}
+	first_undumped = frame_nr + 1;
+	++dumps;
+	dump_pending = true;
+
+	if (!writer.joinable()) writer = std::thread(&FlightRecorder::write_dumps, this);
+	lock.unlock();
+	dump_cv.notify_one();
+}
+
+void FlightRecorder::wait_for_dumps() {
+	std::unique_lock<std::mutex> lock(dump_mutex);
+	dump_cv.wait(lock, [this]() { return !dump_pending; });
+}
+
+void FlightRecorder::write_dumps() {
+	std::unique_lock<std::mutex> lock(dump_mutex);
+	for (;;) {
+		dump_cv.wait(lock, [this]() { return dump_pending || stopping; });
+		if (!dump_pending) return;
+
+		const Frame &hitch = dump_frames[dump_count - 1];
+
+		char timestamp[32];
+		const std::time_t now = std::time(nullptr);
+		std::strftime(timestamp, sizeof(timestamp), "%Y%m%d-%H%M%S", std::localtime(&now));
+		const std::string path = std::string(global::DATA_DIR) + "hitch-" + timestamp
+			+ "-frame" + std::to_string(hitch.number) + ".tsv";
+
+		std::ofstream out(path);
+		out << "# frame " << hitch.number << " took " << hitch.total << " ms, over the budget of "
+			<< global::config.hitch_budget_ms << " ms\n";
+		out << "frame\ttotal_ms\tupdate_ms\tdraw_ms\tpresent_ms\tphysics_ticks\tdraw_calls\trectangles\tallocations\tinputs\tinput_latency_ms\n";
+		for (size_t i = 0; i < dump_count; ++i) {
+			const Frame &frame = dump_frames[i];
+			out << frame.number << '\t' << frame.total << '\t' << frame.update
+				<< '\t' << frame.draw << '\t' << frame.present
+				<< '\t' << frame.physics_ticks << '\t' << frame.draw_calls
+				<< '\t' << frame.rectangles << '\t' << frame.allocations
+				<< '\t' << frame.inputs << '\t' << frame.input_latency << '\n';
+		}
+		out.close();
+
+		if (out) {
+			std::cerr << "INFO: frame " << hitch.number << " took " << hitch.total
+				<< " ms, wrote the last " << dump_count << " frames to " << path << std::endl;
+		} else {
+			std::cerr << "WARN: failed writing the flight recorder's frames to " << path << std::endl;
+		}
+
+		dump_pending = false;
+		// for wait_for_dumps
+		dump_cv.notify_all();
+	}
+}
@@ -0,0 +1,21 @@
+#include "globals.hpp"
+
+#include "config.hpp"
+
+namespace global {
+
+Config config;
+const float SCALE = 1.0f;
+const int FPS = 60;
+int WINDOW_WIDTH = 800 * SCALE;
+int WINDOW_HEIGHT = 600 * SCALE;
+bool quit = false;
+bool check_allocs = false;
+unsigned allocating_frames = 0;
+const char *DATA_DIR = "data/";
+const char *PERSONAL_BESTS_FILE = "personal_bests.dat";
+const char *REPLAYS_DIR = "replays/";
+
+const int PPU = 20 * SCALE;
+
+}
@@ -2,6 +2,8 @@
 
 #include "raylib.h"
 
+#include "flight_recorder.hpp"
+
 Button::Button(callback_t on_click, GuiBox box, std::string text)
 : Button(on_click, box, text, DEFAULT_TEXT_SIZE)
 { }
@@ -68,6 +70,26 @@ void Button::draw() const {
 		box.centre_offset({ -text_width/2.0f, -text_size/2.0f, }),
 		text_size, spacing, text_color
 	);
+	FlightRecorder::get().count_rectangles();
+	FlightRecorder::get().count_draw_calls();
+}
+
+Vector2 Text::abs_pos() const {
+	if (!centered) return pos;
+
+	if (text != measured_text || font_size != measured_size) {
+		// from raylib/src/rtext.c:1195
+		const float spacing = font_size / 10.0f;
+
+		measured_text = text;
+		measured_size = font_size;
+		measured_width = MeasureTextEx(
+			GetFontDefault(), text.c_str(), font_size, spacing
+		).x;
+	}
+
+	const float x_centre = global::WINDOW_WIDTH / 2.0f - pos.x;
+	return { x_centre - measured_width/2, pos.y };
 }
 
 void Text::draw() const {
@@ -78,4 +100,5 @@ void Text::draw() const {
 		GetFontDefault(), text.c_str(), abs_pos(), font_size, spacing,
 		color
 	);
+	FlightRecorder::get().count_draw_calls();
 }
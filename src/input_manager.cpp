@@ -1,7 +1,11 @@
 #include "input_manager.hpp"
 
+#include <iostream>
+
 #include "raylib.h"
 
+#include "profiler.hpp"
+
 InputManager::InputManager()
 : pressCallbacks{}, releaseCallbacks{}, sustainCallbacks{} { }
 
@@ -12,35 +16,97 @@ InputManager& InputManager::get() {
 	return instance;
 }
 
-void InputManager::handleInputs() const {
-	for (auto &item : pressCallbacks) {
-		if (IsKeyPressed(item.first)) item.second();
-	}
-	for (auto &item : releaseCallbacks) {
-		if (IsKeyReleased(item.first)) item.second();
+void InputManager::handleInputs() {
+	PROFILE_ZONE("InputManager::handleInputs");
+
+	// only the keys with callbacks are ever looked at, and only once each
+	KeySet down;
+	boundKeys.for_each([&](KeyboardKey key) {
+		if (IsKeyDown(key)) down.set(key);
+	});
+	const KeySet changed = down ^ downKeys;
+	const KeySet pressed = changed & down;
+	const KeySet released = changed & downKeys;
+
+	// raylib also queues every key press it sees, which catches the
+	// presses the snapshot can't: keys pressed and released again within
+	// a frame, and keys released and pressed again within a frame
+	KeySet queued;
+	for (int key = GetKeyPressed(); key != 0; key = GetKeyPressed()) {
+		if (KeySet::valid(key)) queued.set(key);
 	}
+	const KeySet missed = (queued & boundKeys) ^ (queued & pressed);
+	const KeySet missed_down = missed & down & downKeys;
+	const KeySet tapped = missed ^ missed_down;
+	downKeys = down;
+
+	const auto press = [&](KeyboardKey key) {
+		for (const auto &callback : pressCallbacks[key]) callback();
+	};
+	const auto release = [&](KeyboardKey key) {
+		for (const auto &callback : releaseCallbacks[key]) callback();
+	};
+	(pressed & pressKeys).for_each(press);
+	(released & releaseKeys).for_each(release);
+	missed_down.for_each([&](KeyboardKey key) {
+		release(key);
+		press(key);
+	});
+	tapped.for_each([&](KeyboardKey key) {
+		press(key);
+		release(key);
+	});
 	const float dt = GetFrameTime();
-	for (auto &item : sustainCallbacks) {
-		if (IsKeyDown(item.first)) item.second(dt);
-	}
+	(down & sustainKeys).for_each([&](KeyboardKey key) {
+		for (const auto &callback : sustainCallbacks[key]) callback(dt);
+	});
+}
+
+void InputManager::updateBoundKeys() {
+	boundKeys = pressKeys | releaseKeys | sustainKeys;
+}
+
+// registration is rare, so it is fine for it to log and check
+static bool check_key(KeyboardKey key) {
+	if (KeySet::valid(key)) return true;
+	std::cerr << "WARN: tried to bind invalid key code " << int(key) << std::endl;
+	return false;
 }
 
 void InputManager::registerPress(KeyboardKey key, const std::function<void()> callback) {
-	pressCallbacks.insert(std::make_pair(key, callback));
+	if (!check_key(key)) return;
+	pressCallbacks[key].push_back(callback);
+	pressKeys.set(key);
+	updateBoundKeys();
 }
 void InputManager::registerRelease(KeyboardKey key, const std::function<void()> callback) {
-	releaseCallbacks.insert(std::make_pair(key, callback));
+	if (!check_key(key)) return;
+	releaseCallbacks[key].push_back(callback);
+	releaseKeys.set(key);
+	updateBoundKeys();
 }
 void InputManager::deregisterPress(KeyboardKey key) {
-	pressCallbacks.erase(key);
+	if (!KeySet::valid(key)) return;
+	pressCallbacks[key].clear();
+	pressKeys.reset(key);
+	updateBoundKeys();
 }
 void InputManager::deregisterRelease(KeyboardKey key) {
-	releaseCallbacks.erase(key);
+	if (!KeySet::valid(key)) return;
+	releaseCallbacks[key].clear();
+	releaseKeys.reset(key);
+	updateBoundKeys();
 }
 
 void InputManager::registerSustain(KeyboardKey key, const std::function<void(float dt)> callback) {
-	sustainCallbacks.insert(std::make_pair(key, callback));
+	if (!check_key(key)) return;
+	sustainCallbacks[key].push_back(callback);
+	sustainKeys.set(key);
+	updateBoundKeys();
 }
 void InputManager::deregisterSustain(KeyboardKey key) {
-	sustainCallbacks.erase(key);
+	if (!KeySet::valid(key)) return;
+	sustainCallbacks[key].clear();
+	sustainKeys.reset(key);
+	updateBoundKeys();
 }
@@ -1,17 +1,30 @@
 #include "level.hpp"
 
 #include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
 #include <iostream>
 #include <memory>
 #include <optional>
 #include <string>
+#include <thread>
+#include <utility>
+#include <vector>
 
 #include "raylib.h"
 
 #include "actions.hpp"
+#include "alloc_counter.hpp"
+#include "chunk_renderer.hpp"
+#include "config.hpp"
+#include "flight_recorder.hpp"
 #include "globals.hpp"
 #include "levels_list.hpp"
 #include "player.hpp"
+#include "profiler.hpp"
+#include "util.hpp"
 
 void LevelText::draw(const Level &level, const Camera2D &camera) const {
 	const Vector2 lvl_offset = level.get_offset();
@@ -24,17 +37,123 @@ void LevelText::draw(const Level &level, const Camera2D &camera) const {
 	const float spacing = font_size / 10.0f;
 
 	DrawTextEx(GetFontDefault(), text.c_str(), scr_pos, font_size, spacing, color);
+	FlightRecorder::get().count_draw_calls();
 }
 
-Level::Level(size_t level_nr, std::vector<Tile> tiles, int w, int h,
-	     Vector2 player_spawn, bool continuous)
-: tiles(tiles), w(w), h(h), player(std::make_unique<Player>(stats)),
-  player_spawn { player_spawn.x, h + player_spawn.y }, level_nr(level_nr),
-  pause_overlay(), win_overlay(), continuous(continuous)
+// The hash doesn't depend on how the grid happens to be stored (the order of
+// the palette, or which chunks are allocated), only on the tile in each cell,
+// so a level hashes the same whether it was decoded from its image or loaded
+// from its cooked file.
+static uint64_t hash_level(const TileGrid &tiles, Vector2 spawn) {
+	util::Hash hash;
+	hash.add(tiles.width());
+	hash.add(tiles.height());
+	hash.add(spawn.x);
+	hash.add(spawn.y);
+
+	const auto &palette = tiles.get_palette();
+	std::vector<uint64_t> tile_hashes;
+	std::vector<bool> is_air;
+	tile_hashes.reserve(palette.size());
+	is_air.reserve(palette.size());
+	for (const auto &tile : palette) {
+		is_air.push_back(tile == Tile());
+
+		util::Hash tile_hash;
+		tile_hash.add(tile.type);
+		tile_hash.add(tile.color.r);
+		tile_hash.add(tile.color.g);
+		tile_hash.add(tile.color.b);
+		tile_hash.add(tile.color.a);
+		tile_hash.add(tile.in_front);
+		tile_hash.add(tile.bounce.top);
+		tile_hash.add(tile.bounce.bottom);
+		tile_hash.add(tile.bounce.side);
+		tile_hash.add(tile.friction);
+		tile_hashes.push_back(tile_hash.value);
+	}
+
+	// air is skipped, so only the filled chunks need to be visited
+	for (int cy = 0; cy < tiles.chunks_height(); ++cy) {
+		for (int cx = 0; cx < tiles.chunks_width(); ++cx) {
+			if (tiles.chunk_empty(cx, cy)) continue;
+			const auto *cells = tiles.chunk_cells(cx, cy);
+			for (int i = 0; i < TileGrid::CHUNK_SIZE*TileGrid::CHUNK_SIZE; ++i) {
+				if (is_air[cells[i]]) continue;
+				const int x = cx*TileGrid::CHUNK_SIZE + (i & TileGrid::CHUNK_MASK);
+				const int y = cy*TileGrid::CHUNK_SIZE + (i >> TileGrid::CHUNK_BITS);
+				hash.add(x);
+				hash.add(y);
+				hash.add(tile_hashes[cells[i]]);
+			}
+		}
+	}
+
+	return hash.value;
+}
+
+// the number of visible tiles drawn in front of the player
+static size_t count_front_tiles(const TileGrid &tiles) {
+	const auto &palette = tiles.get_palette();
+	size_t res = 0;
+	for (int cy = 0; cy < tiles.chunks_height(); ++cy) {
+		for (int cx = 0; cx < tiles.chunks_width(); ++cx) {
+			if (tiles.chunk_empty(cx, cy)) continue;
+			const auto *cells = tiles.chunk_cells(cx, cy);
+			for (int i = 0; i < TileGrid::CHUNK_SIZE*TileGrid::CHUNK_SIZE; ++i) {
+				const Tile &tile = palette[cells[i]];
+				if (tile.in_front && tile.color.a != 0) ++res;
+			}
+		}
+	}
+	return res;
+}
+
+// the recording has room for this much of an attempt before it has to grow
+static constexpr uint32_t RESERVED_TICKS = 10 * 60 * global::PHYSICS_FPS; // ten minutes
+static constexpr size_t RESERVED_RUNS = 4096;
+
+// for levels too large to bake up front: how many chunks are baked each frame,
+// and how many chunks past the edges of the screen to bake ahead
+static constexpr size_t BAKES_PER_FRAME = 4;
+static constexpr int BAKE_AHEAD_CHUNKS = 2;
+
+// the most physics ticks to run in one frame, from the time the config allows
+// catching up on, so that it is the same time at any tick rate
+static uint32_t max_ticks_per_frame() {
+	const int ms = global::config.max_catch_up_ms;
+	if (ms <= 0) return FixedStepScheduler::UNLIMITED;
+	// at least one tick, or the level would never get anywhere
+	return std::max<int64_t>(1, int64_t(ms) * global::PHYSICS_FPS / 1000);
+}
+
+bool LevelData::check_size(const std::string &path, int64_t w, int64_t h) {
+	if (w <= MAX_WIDTH && h <= MAX_HEIGHT) return true;
+	std::cerr << "ERROR: level " << path << " is " << w << "x" << h
+		<< " tiles, larger than the " << MAX_WIDTH << "x" << MAX_HEIGHT
+		<< " the physics can handle" << std::endl;
+	return false;
+}
+
+LevelData::LevelData(TileGrid tiles, Vector2 spawn, std::vector<LevelText> texts)
+: tiles(std::move(tiles)), spawn(spawn), texts(std::move(texts)),
+  colliders(this->tiles), content_hash(hash_level(this->tiles, spawn))
+{ }
+
+Level::Level(size_t level_nr, std::shared_ptr<const LevelData> data,
+	     bool continuous)
+: data(std::move(data)), tiles(this->data->tiles),
+  w(tiles.width()), h(tiles.height()), sim(this->data),
+  recording(level_nr, *this->data, global::config.record_state_hashes),
+  level_nr(level_nr), pause_overlay(), win_overlay(),
+  scheduler(global::PHYSICS_FPS, max_ticks_per_frame()),
+  continuous(continuous), chunk_renderer(tiles)
 {
-	player->spawn(get_player_spawn());
+	add_texts(this->data->texts);
+	recording.reserve(RESERVED_TICKS, RESERVED_RUNS);
+	draw_after.reserve(count_front_tiles(tiles));
 
-	camera.target = get_player_spawn();
+	camera.target = sim.get_player_spawn();
 	camera.offset = {
 		global::WINDOW_WIDTH / 2.0f,
 		global::WINDOW_HEIGHT / 2.0f,
@@ -42,6 +161,10 @@ Level::Level(size_t level_nr, std::vector<Tile> tiles, int w, int h,
 	camera.rotation = 0;
 	camera.zoom = global::PPU;
 
+	// whatever is on screen at the start is baked right away, as the level
+	// is still being loaded
+	if (!chunk_renderer.all_baked()) bake_ahead(SIZE_MAX);
+
 	pause_action = Action::Pause.register_cb([this]() {
 		if (state == Level::State::Paused) {
 			state = Level::State::Active;
@@ -87,7 +210,7 @@ Level::Level(size_t level_nr, std::vector<Tile> tiles, int w, int h,
 			if (this->continuous && state == Level::State::WinScreen) {
 				return;
 			}
-			++this->stats.restarts;
+			this->sim.count_restart();
 			change = Level::Change::Reset;
 		},
 		GuiBox::floating_x(
@@ -147,7 +270,7 @@ Level::Level(size_t level_nr, std::vector<Tile> tiles, int w, int h,
 	}
 
 	reset_action = Action::Reset.register_cb([this]() {
-		++this->stats.restarts;
+		this->sim.count_restart();
 		change = Level::Change::Reset;
 	});
 	next_level_action = Action::NextLevel.register_cb([this]() {
@@ -155,59 +278,290 @@ Level::Level(size_t level_nr, std::vector<Tile> tiles, int w, int h,
 			change = Level::Change::Next;
 		}
 	});
+	#ifdef DEBUG
+	// slow motion and fast-forward, for looking at the physics closely
+	// (or getting through a level quickly)
+	slow_down_action = Action::SlowDown.register_cb([this]() {
+		scheduler.set_time_scale(std::max(scheduler.get_time_scale() / 2, 1.0 / 8));
+	});
+	speed_up_action = Action::SpeedUp.register_cb([this]() {
+		scheduler.set_time_scale(std::min(scheduler.get_time_scale() * 2, 8.0));
+	});
+	#endif
+
+	initial_snapshot = snapshot();
 }
 
 Vector2 Level::get_offset() const {
-	return { -w/2.0f, -float(h) };
+	return sim.get_offset();
 }
 int Level::get_level_nr() const {
 	return level_nr;
 }
 const Stats &Level::get_stats() const {
-	return stats;
+	return sim.get_stats();
+}
+const Simulation &Level::get_simulation() const {
+	return sim;
 }
 
-static std::vector<Tile> tilemap_of(Image image) {
-	std::vector<Tile> tiles;
+// colours are packed into a single 32-bit integer so that they can be compared
+// in one go, with the red channel in the lowest byte
+static constexpr uint32_t pack_color(uint8_t r, uint8_t g, uint8_t b, uint8_t a) {
+	return uint32_t(r) | uint32_t(g) << 8 | uint32_t(b) << 16 | uint32_t(a) << 24;
+}
 
-	tiles.reserve(image.width*image.height);
-	using namespace Levels;
-	for (int y = 0; y < image.height; ++y) {
-		for (int x = 0; x < image.width; ++x) {
-			const auto color = GetImageColor(image, x, y);
-			for (int i = 0; i < int(sizeof(colormap)/sizeof(*colormap)); ++i) {
-				const auto r = colormap[i].color.r == color.r;
-				const auto g = colormap[i].color.g == color.g;
-				const auto b = colormap[i].color.b == color.b;
-				const auto a = colormap[i].color.a == color.a;
-				if (r && g && b && a) {
-					tiles.push_back(colormap[i].tile);
-					goto matched_color;
+// Colours are looked up in the colormap through a perfect hash table which is
+// generated at compile time: multiplicative hashing, where the multiplier is
+// searched for such that no two colours in the colormap land in the same slot.
+// This way looking up a pixel's colour is a multiply, a shift, and a single
+// comparison, regardless of the size of the colormap.
+namespace color_hash {
+
+constexpr int colormap_len = sizeof(Levels::colormap)/sizeof(*Levels::colormap);
+constexpr int BITS = 6;
+constexpr int SLOTS = 1 << BITS;
+static_assert(colormap_len <= SLOTS/2, "colormap too large for the colour hash table");
+
+constexpr uint32_t hash(uint32_t color, uint32_t mul) {
+	return (color * mul) >> (32 - BITS);
+}
+
+constexpr uint32_t colormap_color(int i) {
+	const Color color = Levels::colormap[i].color;
+	return pack_color(color.r, color.g, color.b, color.a);
+}
+
+constexpr bool is_perfect(uint32_t mul) {
+	bool used[SLOTS] = {};
+	for (int i = 0; i < colormap_len; ++i) {
+		const uint32_t slot = hash(colormap_color(i), mul);
+		if (used[slot]) return false;
+		used[slot] = true;
+	}
+	return true;
+}
+
+struct Slot {
+	uint32_t color = 0;
+	int colormap_ix = -1; // -1 for empty slots
+};
+struct Table {
+	uint32_t mul = 0;
+	Slot slots[SLOTS] = {};
+};
+
+constexpr Table make_table() {
+	Table res;
+	// start from the golden ratio, only odd multipliers are any good
+	for (uint32_t mul = 0x9E3779B1u; mul < 0x9E3779B1u + (1u << 20); mul += 2) {
+		if (!is_perfect(mul)) continue;
+
+		res.mul = mul;
+		for (int i = 0; i < colormap_len; ++i) {
+			res.slots[hash(colormap_color(i), mul)] = { colormap_color(i), i };
+		}
+		break;
+	}
+	return res;
+}
+
+constexpr Table table = make_table();
+static_assert(table.mul != 0, "no perfect hash found for the colormap");
+
+constexpr int lookup(uint32_t color) {
+	const Slot &slot = table.slots[hash(color, table.mul)];
+	return slot.color == color ? slot.colormap_ix : -1;
+}
+
+}
+
+namespace {
+
+// tracks pixels of unknown colours, so that they can be reported all together
+struct UnknownColors {
+	static constexpr size_t MAX_TRACKED = 16;
+
+	struct Entry {
+		uint32_t color;
+		size_t count;
+		int x, y; // first occurrence
+	};
+	std::vector<Entry> entries = {};
+	size_t untracked = 0; // pixels of colours past the first MAX_TRACKED
+
+	void add(uint32_t color, int x, int y) {
+		for (auto &entry : entries) {
+			if (entry.color == color) {
+				++entry.count;
+				return;
+			}
+		}
+		if (entries.size() < MAX_TRACKED) {
+			entries.push_back({ color, 1, x, y });
+		} else {
+			++untracked;
+		}
+	}
+	void merge(const UnknownColors &other) {
+		for (const auto &other_entry : other.entries) {
+			bool found = false;
+			for (auto &entry : entries) {
+				if (entry.color != other_entry.color) continue;
+				entry.count += other_entry.count;
+				// keep the first occurrence in reading order
+				if (std::make_pair(other_entry.y, other_entry.x) < std::make_pair(entry.y, entry.x)) {
+					entry.x = other_entry.x;
+					entry.y = other_entry.y;
 				}
+				found = true;
+				break;
+			}
+			if (found) continue;
+			if (entries.size() < MAX_TRACKED) {
+				entries.push_back(other_entry);
+			} else {
+				untracked += other_entry.count;
 			}
-			std::cerr << "WARN: Unknown color " << int(color.r) << ' ' << int(color.g) << ' ' << int(color.b) << ' ' << int(color.a) << " in level image at " << x << ", " << y << std::endl;
-			tiles.push_back(air);
-		matched_color:;
 		}
+		untracked += other.untracked;
 	}
+	void report() const {
+		if (entries.empty() && untracked == 0) return;
+
+		size_t total = untracked;
+		for (const auto &entry : entries) total += entry.count;
+
+		std::cerr << "WARN: " << total << " pixel(s) of unknown colours in level image, loading them as air:\n";
+		for (const auto &entry : entries) {
+			std::cerr << "WARN:   color "
+				<< (entry.color & 0xff) << ' '
+				<< (entry.color >> 8 & 0xff) << ' '
+				<< (entry.color >> 16 & 0xff) << ' '
+				<< (entry.color >> 24 & 0xff) << ": "
+				<< entry.count << " pixel(s), first at "
+				<< entry.x << ", " << entry.y << '\n';
+		}
+		if (untracked > 0) {
+			std::cerr << "WARN:   and " << untracked << " pixel(s) of other colours\n";
+		}
+		std::cerr << std::flush;
+	}
+};
 
-	return tiles;
 }
 
+// decodes rows [y_begin, y_end) of an RGBA8 image into the tile grid
+static void decode_rows(
+	const uint8_t *pixels, int w, int y_begin, int y_end,
+	const TileGrid::index_t *palette_ix, TileGrid &res,
+	UnknownColors &unknown
+) {
+	for (int y = y_begin; y < y_end; ++y) {
+		const uint8_t *row = pixels + size_t(y)*w*4;
+		for (int x = 0; x < w; ++x) {
+			const uint8_t *px = row + size_t(x)*4;
+			const uint32_t color = pack_color(px[0], px[1], px[2], px[3]);
+
+			const int colormap_ix = color_hash::lookup(color);
+			if (colormap_ix < 0) {
+				unknown.add(color, x, y);
+				continue;
+			}
+
+			const TileGrid::index_t ix = palette_ix[colormap_ix];
+			if (ix != 0) res.set(x, y, ix);
+		}
+	}
+}
+
+TileGrid Levels::tilemap_of(Image image) {
+	using namespace Levels;
+	constexpr int colormap_len = color_hash::colormap_len;
+
+	// build the level's palette from the distinct tiles in the colormap,
+	// remembering which palette entry each colour maps to
+	std::vector<Tile> palette = { air };
+	TileGrid::index_t palette_ix[colormap_len];
+	for (int i = 0; i < colormap_len; ++i) {
+		size_t ix = 0;
+		while (ix < palette.size() && palette[ix] != colormap[i].tile) ++ix;
+		if (ix == palette.size()) palette.push_back(colormap[i].tile);
+		palette_ix[i] = ix;
+	}
+
+	TileGrid res(std::move(palette), image.width, image.height);
+
+	// work directly on the pixel buffer, converting the image to RGBA8
+	// first if needed
+	Image rgba = image;
+	const bool converted = image.format != PIXELFORMAT_UNCOMPRESSED_R8G8B8A8;
+	if (converted) {
+		rgba = ImageCopy(image);
+		ImageFormat(&rgba, PIXELFORMAT_UNCOMPRESSED_R8G8B8A8);
+	}
+	const auto *pixels = static_cast<const uint8_t *>(rgba.data);
+
+	// small images aren't worth spinning up threads for
+	const size_t parallel_min_pixels = 1 << 18;
+	const int bands = (image.height + TileGrid::CHUNK_MASK) >> TileGrid::CHUNK_BITS;
+	const int threads = std::min<int>(std::thread::hardware_concurrency(), bands);
+
+	UnknownColors unknown;
+	if (size_t(image.width)*image.height < parallel_min_pixels || threads <= 1) {
+		decode_rows(pixels, image.width, 0, image.height, palette_ix, res, unknown);
+	} else {
+		// split the image into bands of rows one chunk high, so that
+		// no two threads ever touch the same chunk of the grid
+		std::atomic<int> next_band = 0;
+		std::vector<UnknownColors> thread_unknown(threads);
+		std::vector<std::thread> workers;
+		for (int t = 0; t < threads; ++t) {
+			workers.emplace_back([&, t]() {
+				for (int band = next_band++; band < bands; band = next_band++) {
+					const int y_begin = band << TileGrid::CHUNK_BITS;
+					const int y_end = std::min(image.height, y_begin + TileGrid::CHUNK_SIZE);
+					decode_rows(
+						pixels, image.width, y_begin, y_end,
+						palette_ix, res, thread_unknown[t]
+					);
+				}
+			});
+		}
+		for (auto &worker : workers) worker.join();
+		for (const auto &e : thread_unknown) unknown.merge(e);
+	}
+	unknown.report();
+
+	if (converted) UnloadImage(rgba);
+
+	return res;
+}
+
+Level::Level(size_t level_nr, TileGrid tiles, Vector2 player_spawn,
+	     bool continuous)
+: Level(
+	level_nr,
+	std::make_shared<const LevelData>(
+		std::move(tiles), player_spawn, std::vector<LevelText>{}
+	),
+	continuous
+)
+{ }
 Level::Level(size_t level_nr, const Tile *tilemap, int w, int h,
 	     Vector2 player_spawn)
 : Level(level_nr, tilemap, w, h, player_spawn, false)
 { }
 Level::Level(size_t level_nr, const Tile *tilemap, int w, int h,
 	     Vector2 player_spawn, bool continuous)
-: Level(level_nr, { tilemap, tilemap + w*h }, w, h, player_spawn, continuous)
+: Level(level_nr, TileGrid(tilemap, w, h), player_spawn, continuous)
 { }
 Level::Level(size_t level_nr, Image image, Vector2 player_spawn)
 : Level(level_nr, image, player_spawn, false)
 { }
 Level::Level(size_t level_nr, Image image, Vector2 player_spawn,
 	     bool continuous)
-: Level(level_nr, tilemap_of(image), image.width, image.height, player_spawn, continuous)
+: Level(level_nr, Levels::tilemap_of(image), player_spawn, continuous)
 { }
 void Level::add_texts(std::vector<LevelText> texts) {
 	for (const auto &text : texts) {
@@ -216,53 +570,67 @@ void Level::add_texts(std::vector<LevelText> texts) {
 	}
 }
 Level::~Level() = default;
-Vector2 Level::get_player_spawn() const {
-	const auto offset = get_offset();
-
-	return { player_spawn.x + offset.x + 0.5f, player_spawn.y + offset.y };
+Level::Snapshot Level::snapshot() const {
+	return {
+		sim.snapshot(), camera, camera_move_time, state,
+		has_populated_winscreen, scheduler.snapshot(), change,
+	};
 }
-
-void Level::respawn_player() {
-	player->spawn(get_player_spawn());
+void Level::restore(const Snapshot &snapshot) {
+	sim.restore(snapshot.sim);
+	// inputs given before the restore shouldn't carry over
+	controls.clear();
+	// every tick is recorded, so the recording is cut back to the
+	// restored tick
+	recording.truncate(snapshot.sim.stats.time);
+	camera = snapshot.camera;
+	camera_move_time = snapshot.camera_move_time;
+	state = snapshot.state;
+	has_populated_winscreen = snapshot.has_populated_winscreen;
+	scheduler.restore(snapshot.scheduler);
+	change = snapshot.change;
 }
-void Level::display_win_overlay() {
-	state = Level::State::WinScreen;
+void Level::reset() {
+	restore(initial_snapshot);
 }
 
-Rectangle Level::get_collider(float x, float y) const {
-	const auto offset = get_offset();
-	const int lvl_x = x - offset.x;
-	const int lvl_y = y - offset.y;
-	if (lvl_x < 0 || lvl_x >= w || lvl_y < 0 || lvl_y >= h) {
-		return { 0, 0, 0, 0 };
-	}
-	const auto &tile = tiles[lvl_x + lvl_y*w];
-	if (tile.type == TileType::Empty) {
-		return { 0, 0, 0, 0 };
-	}
-	return { lvl_x + offset.x, lvl_y + offset.y, 1, 1 };
-}
-Tile Level::get_tile(float x, float y) const {
-	const auto offset = get_offset();
-	const int lvl_x = x - offset.x;
-	const int lvl_y = y - offset.y;
-	if (lvl_x < 0 || lvl_x >= w || lvl_y < 0 || lvl_y >= h) {
-		return Tile();
+void Level::check_allocations() {
+	const uint64_t allocations = alloc_counter::count();
+	// only a whole frame spent playing the level is checked, ie. since the
+	// last update, which the level was active for, including its drawing
+	if (was_active && state == Level::State::Active && allocations != allocations_at_update) {
+		std::cerr << "ERROR: " << allocations - allocations_at_update
+			<< " heap allocation(s) in a frame while playing level "
+			<< level_nr + 1 << std::endl;
+		++global::allocating_frames;
 	}
-	return tiles[lvl_x + lvl_y*w];
+	allocations_at_update = allocations;
+	was_active = state == Level::State::Active;
 }
-void Level::activate_checkpoint(float x, float y) {
+
+void Level::bake_ahead(size_t budget) {
+	PROFILE_ZONE("Level::bake_ahead");
 	const auto offset = get_offset();
-	const int lvl_x = x - offset.x;
-	const int lvl_y = y - offset.y;
-	if (lvl_x < 0 || lvl_x >= w || lvl_y < 0 || lvl_y >= h) {
-		return;
-	}
-	active_checkpoint = { float(lvl_x), float(lvl_y) };
-	player_spawn = { float(lvl_x), lvl_y + 1.f };
+	const float half_width = global::WINDOW_WIDTH / camera.zoom / 2.f;
+	const float half_height = global::WINDOW_HEIGHT / camera.zoom / 2.f;
+	const int cx_min = int(std::floor(camera.target.x - offset.x - half_width)) >> TileGrid::CHUNK_BITS;
+	const int cx_max = int(std::floor(camera.target.x - offset.x + half_width)) >> TileGrid::CHUNK_BITS;
+	const int cy_min = int(std::floor(camera.target.y - offset.y - half_height)) >> TileGrid::CHUNK_BITS;
+	const int cy_max = int(std::floor(camera.target.y - offset.y + half_height)) >> TileGrid::CHUNK_BITS;
+
+	budget -= chunk_renderer.bake_area(tiles, cx_min, cy_min, cx_max, cy_max, budget);
+	chunk_renderer.bake_area(
+		tiles,
+		cx_min - BAKE_AHEAD_CHUNKS, cy_min - BAKE_AHEAD_CHUNKS,
+		cx_max + BAKE_AHEAD_CHUNKS, cy_max + BAKE_AHEAD_CHUNKS,
+		budget
+	);
 }
 
 void Level::update(float dt) {
+	PROFILE_ZONE("Level::update");
+	if (global::check_allocs) check_allocations();
+	if (!chunk_renderer.all_baked()) bake_ahead(BAKES_PER_FRAME);
 	switch (state) {
 		case Level::State::Paused: {
 			pause_overlay.update(dt);
@@ -272,8 +640,10 @@ void Level::update(float dt) {
 				// populate win screen with level stats
 				has_populated_winscreen = true;
 
+				const Stats &stats = sim.get_stats();
+
 				PBFile pbs_file = PBFile::load();
-				const std::string key = std::to_string(level_nr);
+				const std::string key = pb_key(std::to_string(level_nr));
 				auto pb = pbs_file.get(key);
 
 				const bool new_pb = pb == nullptr || stats.better_than(*pb);
@@ -284,12 +654,9 @@ void Level::update(float dt) {
 				const std::string stats_label = "Time / Jumps / Deaths: ";
 				std::string stats_value;
 
-				const unsigned seconds = stats.time / global::PHYSICS_FPS;
-				const unsigned frames = stats.time % global::PHYSICS_FPS;
-				stats_value += std::to_string(seconds);
-				stats_value += ";";
-				if (frames < 10) stats_value += "0";
-				stats_value += std::to_string(frames);
+				char time_str[32];
+				format_time(time_str, sizeof(time_str), stats.time);
+				stats_value += time_str;
 
 				stats_value += " / ";
 
@@ -310,12 +677,9 @@ void Level::update(float dt) {
 				if (pb == nullptr) {
 					pb_value = "N/A";
 				} else {
-					const unsigned seconds = pb->time / global::PHYSICS_FPS;
-					const unsigned frames = pb->time % global::PHYSICS_FPS;
-					pb_value += std::to_string(seconds);
-					pb_value += ";";
-					if (frames < 10) pb_value += "0";
-					pb_value += std::to_string(frames);
+					char time_str[32];
+					format_time(time_str, sizeof(time_str), pb->time);
+					pb_value += time_str;
 
 					pb_value += " / ";
 
@@ -331,6 +695,9 @@ void Level::update(float dt) {
 				if (new_pb) {
 					pbs_file.set(key, stats);
 					pbs_file.save();
+
+					recording.stats = stats;
+					recording.save(Replay::path_for(level_nr));
 				}
 			}
 
@@ -339,21 +706,35 @@ void Level::update(float dt) {
 		case Level::State::Active: break;
 	}
 
-	if (state != Level::State::Active) return;
+	if (state != Level::State::Active) {
+		// inputs given while not playing shouldn't carry over
+		controls.clear();
+		return;
+	}
 
-	// only update the player's physics on each physics tick
-	frame_acc += dt;
-	const bool physics_tick = frame_acc >= 1.0f/global::PHYSICS_FPS;
-	if (physics_tick) {
-		while (frame_acc >= 1.0f/global::PHYSICS_FPS) {
-			frame_acc -= 1.0f/global::PHYSICS_FPS;
+	// run as many physics ticks as are due, catching up after slow frames
+	scheduler.run(dt, [this]() {
+		PROFILE_ZONE("physics tick");
+		FlightRecorder::get().count_physics_tick();
+		// the presses are timed up to the start of the tick they're
+		// applied on
+		const double tick_start = GetTime();
+		const auto inputs = controls.take([this, tick_start](MotionInputs input, double time) {
+			const double latency = tick_start - time;
+			recording.record_latency(input, uint32_t(latency * 1e6));
+			FlightRecorder::get().count_input(latency * 1e3);
+		});
+		recording.record(inputs);
+		sim.tick(inputs);
+		if (recording.has_hashes()) recording.record_hash(sim.state_hash());
+		if (sim.is_completed()) {
+			state = Level::State::WinScreen;
+			return false;
 		}
-		++stats.time;
-
-		player->update(*this);
-	}
+		return true;
+	});
 
-	const auto player_pos = player->get_pos(frame_acc * global::PHYSICS_FPS);
+	const auto player_pos = sim.get_player().get_pos(scheduler.alpha());
 	const Vector2 d = {
 		player_pos.x - camera.target.x,
 		player_pos.y - camera.target.y,
@@ -376,6 +757,8 @@ void Level::update(float dt) {
 	};
 }
 void Level::draw() const {
+	PROFILE_ZONE("Level::draw");
+	FlightRecorder &recorder = FlightRecorder::get();
 	ClearBackground(RAYWHITE);
 
 	for (const auto &text : texts) {
@@ -385,7 +768,7 @@ void Level::draw() const {
 	BeginMode2D(camera);
 
 	const auto offset = get_offset();
-	std::vector<std::pair<Rectangle, Color>> draw_after {};
+	draw_after.clear();
 
 	const float viewport_width = global::WINDOW_WIDTH / camera.zoom;
 	const float viewport_height = global::WINDOW_HEIGHT / camera.zoom;
@@ -407,73 +790,172 @@ void Level::draw() const {
 	const int x_min = std::max(viewport_left, 0.f);
 	const int x_max = std::min(viewport_right, float(w-1));
 
-	// only loop over visible tiles
-	for (int y = y_min; y <= y_max; ++y) {
-		for (int x = x_min; x <= x_max; ++x) {
-			const Vector2 pos = { x + offset.x, y + offset.y };
-			const Vector2 size = { 1, 1 };
+	// tiles far enough from the edges of the viewport aren't faded, so
+	// they are drawn straight from the chunks' baked textures, and only the
+	// faded border is drawn tile by tile
+	const int inner_y_min = std::ceil(viewport_top + fade_dist - 1);
+	const int inner_y_max = std::floor(viewport_bottom - fade_dist);
+	const int inner_x_min = std::ceil(viewport_left + fade_dist - 1);
+	const int inner_x_max = std::floor(viewport_right - fade_dist);
+
+	// the visible and unfaded tiles of a chunk, in level coordinates
+	struct ChunkArea {
+		int x_min, x_max;
+		int y_min, y_max;
+		int inner_x_min, inner_x_max;
+		int inner_y_min, inner_y_max;
+		bool has_inner;
+
+		Rectangle inner_source(int cx, int cy) const {
+			return {
+				float(inner_x_min - (cx << TileGrid::CHUNK_BITS)),
+				float(inner_y_min - (cy << TileGrid::CHUNK_BITS)),
+				float(inner_x_max - inner_x_min + 1),
+				float(inner_y_max - inner_y_min + 1),
+			};
+		}
+		Rectangle inner_dest(Vector2 offset) const {
+			return {
+				inner_x_min + offset.x, inner_y_min + offset.y,
+				float(inner_x_max - inner_x_min + 1),
+				float(inner_y_max - inner_y_min + 1),
+			};
+		}
+	};
+	const auto chunk_area = [&](int cx, int cy) {
+		ChunkArea res;
+		res.y_min = std::max(y_min, cy << TileGrid::CHUNK_BITS);
+		res.y_max = std::min(y_max, (cy << TileGrid::CHUNK_BITS) + TileGrid::CHUNK_MASK);
+		res.x_min = std::max(x_min, cx << TileGrid::CHUNK_BITS);
+		res.x_max = std::min(x_max, (cx << TileGrid::CHUNK_BITS) + TileGrid::CHUNK_MASK);
+		res.inner_y_min = std::max(res.y_min, inner_y_min);
+		res.inner_y_max = std::min(res.y_max, inner_y_max);
+		res.inner_x_min = std::max(res.x_min, inner_x_min);
+		res.inner_x_max = std::min(res.x_max, inner_x_max);
+		res.has_inner = res.inner_x_min <= res.inner_x_max
+			&& res.inner_y_min <= res.inner_y_max;
+		return res;
+	};
 
-			const float y_dist = std::min(y + size.y - viewport_top, viewport_bottom - y);
-			const float x_dist = std::min(x + size.x - viewport_left, viewport_right - x);
-			const float dist = std::min(x_dist, y_dist);
+	// only loop over visible chunks, skipping over chunks of the level
+	// which contain only air
+	const int cy_min = y_min >> TileGrid::CHUNK_BITS;
+	const int cy_max = y_max >> TileGrid::CHUNK_BITS;
+	const int cx_min = x_min >> TileGrid::CHUNK_BITS;
+	const int cx_max = x_max >> TileGrid::CHUNK_BITS;
+	for (int cy = cy_min; cy <= cy_max; ++cy) for (int cx = cx_min; cx <= cx_max; ++cx) {
+		if (tiles.chunk_empty(cx, cy)) continue;
+		PROFILE_ZONE("Level::draw chunk");
+
+		const ChunkArea area = chunk_area(cx, cy);
+		// a chunk which isn't baked yet is drawn entirely tile by tile
+		const auto *layers = chunk_renderer.get(cx, cy);
+		const bool baked_inner = area.has_inner && layers != nullptr;
+		if (baked_inner && layers->back.id != 0) {
+			DrawTexturePro(
+				layers->back, area.inner_source(cx, cy),
+				area.inner_dest(offset), { 0, 0 }, 0, WHITE
+			);
+			recorder.count_draw_calls();
+		}
 
-			const float factor = dist < fade_dist ? dist / fade_dist : 1;
-			const float adj = (1 - factor)/2;
-			const auto color = tiles[x + y*w].color;
+		for (int y = area.y_min; y <= area.y_max; ++y) {
+			const bool inner_row = baked_inner
+				&& y >= area.inner_y_min && y <= area.inner_y_max;
+			for (int x = area.x_min; x <= area.x_max; ++x) {
+				// skip the tiles drawn from the baked chunk
+				if (inner_row && x == area.inner_x_min) {
+					x = area.inner_x_max;
+					continue;
+				}
 
-			// don't draw invisible tiles
-			// (actually saves a lot of time!)
-			if (color.a == 0) continue; // don't draw invisible tiles
+				const Vector2 pos = { x + offset.x, y + offset.y };
+				const Vector2 size = { 1, 1 };
 
-			const Rectangle rect = {
-				pos.x + size.x*adj, pos.y + size.y*adj,
-				size.x*factor, size.y*factor
-			};
+				const float y_dist = std::min(y + size.y - viewport_top, viewport_bottom - y);
+				const float x_dist = std::min(x + size.x - viewport_left, viewport_right - x);
+				const float dist = std::min(x_dist, y_dist);
 
-			// save tiles that should be drawn after the player to
-			// a vector, rather than looping over the tiles again
-			// later
-			if (tiles[x + y*w].in_front) {
-				draw_after.push_back(std::make_pair(rect, color));
-			} else {
-				DrawRectangleRec(rect, color);
+				const float factor = dist < fade_dist ? dist / fade_dist : 1;
+				const float adj = (1 - factor)/2;
+				const Tile &tile = tiles.at(x, y);
+				const auto color = tile.color;
+
+				// don't draw invisible tiles
+				// (actually saves a lot of time!)
+				if (color.a == 0) continue; // don't draw invisible tiles
+
+				const Rectangle rect = {
+					pos.x + size.x*adj, pos.y + size.y*adj,
+					size.x*factor, size.y*factor
+				};
+
+				// save tiles that should be drawn after the player to
+				// a vector, rather than looping over the tiles again
+				// later
+				if (tile.in_front) {
+					draw_after.push_back(std::make_pair(rect, color));
+				} else {
+					DrawRectangleRec(rect, color);
+					recorder.count_rectangles();
+				}
 			}
 		}
 	}
 
+	const auto &active_checkpoint = sim.get_active_checkpoint();
 	if (active_checkpoint.has_value()) {
 		DrawPoly({
 			offset.x + active_checkpoint->x + 0.5f,
 			offset.y + active_checkpoint->y + 0.5f,
 		}, 4, 0.5f, 0, { 127, 255, 127, 195 });
+		recorder.count_draw_calls();
 	}
 
-	player->draw(frame_acc * global::PHYSICS_FPS);
+	sim.get_player().draw(scheduler.alpha());
 
+	for (int cy = cy_min; cy <= cy_max; ++cy) for (int cx = cx_min; cx <= cx_max; ++cx) {
+		if (tiles.chunk_empty(cx, cy)) continue;
+
+		const ChunkArea area = chunk_area(cx, cy);
+		const auto *layers = chunk_renderer.get(cx, cy);
+		if (area.has_inner && layers != nullptr && layers->front.id != 0) {
+			DrawTexturePro(
+				layers->front, area.inner_source(cx, cy),
+				area.inner_dest(offset), { 0, 0 }, 0, WHITE
+			);
+			recorder.count_draw_calls();
+		}
+	}
 	for (const auto &e : draw_after) {
 		DrawRectangleRec(e.first, e.second);
 	}
+	recorder.count_rectangles(draw_after.size());
 
 	EndMode2D();
 
-	std::string level_display = "Level: ";
-	level_display += std::to_string(level_nr + 1);
-	level_display += " / ";
-	level_display += std::to_string(Levels::levels.size());
+	// formatted into fixed buffers rather than strings, so that drawing
+	// doesn't allocate
+	char level_display[48];
+	std::snprintf(level_display, sizeof(level_display), "Level: %zu / %zu", level_nr + 1, Levels::levels.size());
 
 	const int level_display_height = 20;
-	DrawText(level_display.c_str(), 10, 10, level_display_height, BLACK);
-
-	std::string level_time_str = "";
-	const int seconds = stats.time / global::PHYSICS_FPS;
-	const int frames = stats.time % global::PHYSICS_FPS;
-	level_time_str += std::to_string(seconds);
-	level_time_str += ";";
-	if (frames < 10) level_time_str += "0";
-	level_time_str += std::to_string(frames);
+	DrawText(level_display, 10, 10, level_display_height, BLACK);
+	#ifdef DEBUG
+	if (scheduler.get_time_scale() != 1) {
+		char time_scale_str[32];
+		std::snprintf(time_scale_str, sizeof(time_scale_str), "Time: x%g", scheduler.get_time_scale());
+		DrawText(time_scale_str, 10, 20 + level_display_height, level_display_height, BLACK);
+		recorder.count_draw_calls();
+	}
+	#endif
+
+	char level_time_str[32];
+	format_time(level_time_str, sizeof(level_time_str), sim.get_stats().time);
 	const int level_time_str_height = 20;
-	const int level_time_str_width = MeasureText(level_time_str.c_str(), level_time_str_height);
-	DrawText(level_time_str.c_str(), global::WINDOW_WIDTH - 10 - level_time_str_width, 10, level_time_str_height, BLACK);
+	const int level_time_str_width = MeasureText(level_time_str, level_time_str_height);
+	DrawText(level_time_str, global::WINDOW_WIDTH - 10 - level_time_str_width, 10, level_time_str_height, BLACK);
+	recorder.count_draw_calls(2);
 
 	switch (state) {
 		case Level::State::Paused: {
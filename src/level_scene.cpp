@@ -49,9 +49,7 @@ void LevelScene::reset_level() {
 		return;
 	}
 
-	const int curr = level->get_level_nr();
-
-	level = Levels::make_level(curr);
+	level->reset();
 }
 
 void LevelScene::update(float dt) {
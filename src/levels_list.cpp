@@ -1,5 +1,17 @@
 #include "levels_list.hpp"
 
+#include <filesystem>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <system_error>
+#include <utility>
+#include <vector>
+
+#include "cooked_level.hpp"
+
 namespace Levels {
 
 const std::vector<LevelInfo> levels = {
@@ -26,16 +38,119 @@ const std::vector<LevelInfo> levels = {
 std::unique_ptr<Level> make_level(size_t idx) {
 	return make_level(idx, false);
 }
-std::unique_ptr<Level> make_level(size_t idx, bool continuous) {
-	if (idx >= levels.size()) return nullptr;
 
+namespace fs = std::filesystem;
+
+// stands in for the modification time of a file which doesn't exist
+static const fs::file_time_type NO_FILE = fs::file_time_type::min();
+
+static fs::file_time_type modified_time(const std::string &path) {
+	std::error_code ec;
+	const auto res = fs::last_write_time(path, ec);
+	return ec ? NO_FILE : res;
+}
+
+// Decoded levels are cached for the lifetime of the process, keyed by the
+// modification times of the level's files, so that restarting (or returning
+// to) a level only costs a couple of stat calls.
+// Levels are small enough, and few enough, that the cache is never evicted.
+struct CacheEntry {
+	fs::file_time_type image_time;
+	fs::file_time_type cooked_time;
+	std::shared_ptr<const LevelData> data;
+};
+static std::mutex cache_mutex;
+static std::vector<CacheEntry> cache;
+// levels being loaded in the background by prefetch_level_data; declared
+// after the cache, so that on exit the futures (which wait for their worker
+// to finish) are destroyed before anything the workers use
+static std::vector<std::future<std::shared_ptr<const LevelData>>> prefetches;
+
+// the cooked level is only used if it is at least as new as the level image,
+// otherwise changes to the image would silently be ignored
+static bool cooked_up_to_date(fs::file_time_type image_time, fs::file_time_type cooked_time) {
+	if (image_time == NO_FILE) return true; // no image to compare to, trust the cooked level
+	if (cooked_time == NO_FILE) return false;
+	return cooked_time >= image_time;
+}
+
+// returns an empty optional if the level is too large to play
+static std::optional<LevelData> decode_level(size_t idx, fs::file_time_type image_time,
+					     fs::file_time_type cooked_time) {
+	const auto cooked_path = CookedLevel::path_for(levels[idx].filename);
+	if (cooked_up_to_date(image_time, cooked_time)) {
+		auto cooked = CookedLevel::load(cooked_path);
+		if (cooked.has_value()) return cooked;
+	}
+
+	// fall back to decoding the level image
 	const auto level_img = LoadImage(levels[idx].filename.c_str());
-	auto res = std::make_unique<Level>(
-		idx, level_img, levels[idx].spawn, continuous
+	if (!LevelData::check_size(levels[idx].filename, level_img.width, level_img.height)) {
+		UnloadImage(level_img);
+		return {};
+	}
+	std::optional<LevelData> res = LevelData(
+		tilemap_of(level_img), levels[idx].spawn, levels[idx].texts
 	);
-	res->add_texts(levels[idx].texts);
 	UnloadImage(level_img);
 	return res;
 }
 
+std::shared_ptr<const LevelData> load_level_data(size_t idx) {
+	if (idx >= levels.size()) return nullptr;
+
+	const auto image_time = modified_time(levels[idx].filename);
+	const auto cooked_time = modified_time(CookedLevel::path_for(levels[idx].filename));
+
+	{
+		std::lock_guard<std::mutex> lock(cache_mutex);
+		if (cache.size() != levels.size()) cache.resize(levels.size());
+		const auto &entry = cache[idx];
+		if (entry.data != nullptr && entry.image_time == image_time && entry.cooked_time == cooked_time) {
+			return entry.data;
+		}
+	}
+
+	// decode without holding the lock; should two threads race to decode
+	// the same level, both results are equivalent, so either may be kept
+	auto decoded = decode_level(idx, image_time, cooked_time);
+	if (!decoded.has_value()) return nullptr;
+	auto data = std::make_shared<const LevelData>(std::move(*decoded));
+
+	std::lock_guard<std::mutex> lock(cache_mutex);
+	cache[idx] = { image_time, cooked_time, data };
+	return data;
+}
+
+void prefetch_level_data(size_t idx) {
+	if (idx >= levels.size()) return;
+
+	std::lock_guard<std::mutex> lock(cache_mutex);
+	if (prefetches.size() != levels.size()) prefetches.resize(levels.size());
+	if (prefetches[idx].valid()) return; // already being prefetched
+
+	prefetches[idx] = std::async(std::launch::async, load_level_data, idx);
+}
+
+std::unique_ptr<Level> make_level(size_t idx, bool continuous) {
+	if (idx >= levels.size()) return nullptr;
+
+	// wait for the level's prefetch (if any) to finish, which leaves its
+	// data in the cache; loading it then only checks that the level's
+	// files haven't changed since, and retries a prefetch that failed
+	std::future<std::shared_ptr<const LevelData>> prefetched;
+	{
+		std::lock_guard<std::mutex> lock(cache_mutex);
+		if (idx < prefetches.size()) prefetched = std::move(prefetches[idx]);
+	}
+	if (prefetched.valid()) prefetched.wait();
+	auto data = load_level_data(idx);
+	if (data == nullptr) return nullptr;
+
+	// while this level is played, get the next one ready
+	prefetch_level_data(idx + 1);
+
+	return std::make_unique<Level>(idx, std::move(data), continuous);
+}
+
 };
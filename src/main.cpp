@@ -1,18 +1,29 @@
 #include "raylib.h"
 
+#include <cstring>
 #include <filesystem>
 #include <fstream>
 #include <iostream>
 
 #include "actions.hpp"
 #include "config.hpp"
+#include "flight_recorder.hpp"
 #include "input_manager.hpp"
 #include "game.hpp"
 #include "globals.hpp"
 
-int main() {
+int main(int argc, char **argv) {
+	for (int i = 1; i < argc; ++i) {
+		if (std::strcmp(argv[i], "--check-allocs") == 0) {
+			global::check_allocs = true;
+		} else {
+			std::cerr << "WARN: unknown argument " << argv[i] << std::endl;
+		}
+	}
+
 	Game game;
-	const InputManager &inp_mgr = InputManager::get();
+	InputManager &inp_mgr = InputManager::get();
+	FlightRecorder &recorder = FlightRecorder::get();
 
 	for (auto &map : Action::INIT_KEYMAP_ONCE) {
 		map.action.register_key(map.key, map.on_press);
@@ -20,9 +31,6 @@ int main() {
 	for (auto &map : Action::INIT_KEYMAP_STARTSTOP) {
 		map.action.register_key(map.key);
 	}
-	for (auto &map : Action::INIT_KEYMAP_SUSTAIN) {
-		map.action.register_key(map.key);
-	}
 
 	if (!std::filesystem::exists(global::DATA_DIR)) {
 		if (!std::filesystem::create_directory(global::DATA_DIR)) {
@@ -84,31 +92,26 @@ int main() {
 			global::WINDOW_WIDTH = GetScreenWidth();
 			global::WINDOW_HEIGHT = GetScreenHeight();
 		}
+		recorder.begin_frame();
 		inp_mgr.handleInputs();
 		game.update();
+		recorder.end_update();
 		game.draw();
 		game.update_scene();
+		recorder.end_frame();
 	}
 
 	CloseAudioDevice();
 
 	CloseWindow();
 
-	return 0;
-}
-
-namespace global {
-
-Config config;
-const float SCALE = 1.0f;
-const int FPS = 60;
-int WINDOW_WIDTH = 800 * SCALE;
-int WINDOW_HEIGHT = 600 * SCALE;
-bool quit = false;
-const int PHYSICS_FPS = 32;
-const char *DATA_DIR = "data/";
-const char *PERSONAL_BESTS_FILE = "personal_bests.dat";
-
-const int PPU = 20 * SCALE;
+	if (global::check_allocs) {
+		if (global::allocating_frames != 0) {
+			std::cerr << "ERROR: " << global::allocating_frames << " frame(s) allocated while playing a level" << std::endl;
+			return 1;
+		}
+		std::cerr << "INFO: no frames allocated while playing a level" << std::endl;
+	}
 
+	return 0;
 }
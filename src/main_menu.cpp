@@ -7,6 +7,7 @@
 #include "globals.hpp"
 #include "level_scene.hpp"
 #include "level_select.hpp"
+#include "levels_list.hpp"
 
 MainMenu::MainMenu()
 : play {
@@ -26,7 +27,10 @@ MainMenu::MainMenu()
 	GuiBox::floating_x({ 0, 300 }, { 400, 75 }), "QUIT"
   },
   title { "This is a game", 50, { 0, 10 }, true, GRAY }
-{ }
+{
+	// both playing and the challenge run start at the first level
+	Levels::prefetch_level_data(0);
+}
 
 void MainMenu::update(float dt) {
 	play.update(dt);
@@ -0,0 +1,78 @@
+#include "mapped_file.hpp"
+
+#include <memory>
+
+// NOTE: windows.h must not be included in the same translation unit as
+// raylib.h, their names (Rectangle, CloseWindow, DrawText...) clash
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#ifdef _WIN32
+
+std::shared_ptr<const MappedFile> MappedFile::open(const char *path) {
+	std::shared_ptr<MappedFile> res(new MappedFile());
+
+	res->file = CreateFileA(
+		path, GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING,
+		FILE_ATTRIBUTE_NORMAL, nullptr
+	);
+	if (res->file == INVALID_HANDLE_VALUE) {
+		res->file = nullptr;
+		return nullptr;
+	}
+
+	LARGE_INTEGER size;
+	if (!GetFileSizeEx(res->file, &size) || size.QuadPart == 0) return nullptr;
+	res->len = size.QuadPart;
+
+	res->mapping = CreateFileMappingA(
+		res->file, nullptr, PAGE_READONLY, 0, 0, nullptr
+	);
+	if (res->mapping == nullptr) return nullptr;
+
+	res->ptr = static_cast<const unsigned char *>(
+		MapViewOfFile(res->mapping, FILE_MAP_READ, 0, 0, 0)
+	);
+	if (res->ptr == nullptr) return nullptr;
+
+	return res;
+}
+MappedFile::~MappedFile() {
+	if (ptr) UnmapViewOfFile(ptr);
+	if (mapping) CloseHandle(mapping);
+	if (file) CloseHandle(file);
+}
+
+#else
+
+std::shared_ptr<const MappedFile> MappedFile::open(const char *path) {
+	const int fd = ::open(path, O_RDONLY);
+	if (fd < 0) return nullptr;
+
+	struct stat st;
+	if (fstat(fd, &st) != 0 || st.st_size == 0) {
+		close(fd);
+		return nullptr;
+	}
+
+	void *ptr = mmap(nullptr, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+	// the mapping keeps its own reference to the file
+	close(fd);
+	if (ptr == MAP_FAILED) return nullptr;
+
+	std::shared_ptr<MappedFile> res(new MappedFile());
+	res->ptr = static_cast<const unsigned char *>(ptr);
+	res->len = st.st_size;
+	return res;
+}
+MappedFile::~MappedFile() {
+	if (ptr) munmap(const_cast<unsigned char *>(ptr), len);
+}
+
+#endif
@@ -1,6 +1,8 @@
 #include "overlay.hpp"
 
+#include "flight_recorder.hpp"
 #include "globals.hpp"
+#include "profiler.hpp"
 
 Overlay::Overlay() : text{}, buttons{} { }
 
@@ -24,15 +26,18 @@ Button *Overlay::get_button(size_t ix) {
 }
 
 void Overlay::update(float dt) {
+	PROFILE_ZONE("Overlay::update");
 	for (auto &e : buttons) {
 		e.update(dt);
 	}
 }
 void Overlay::draw() const {
+	PROFILE_ZONE("Overlay::draw");
 	DrawRectangle(
 		0, 0, global::WINDOW_WIDTH, global::WINDOW_HEIGHT,
 		{ 195, 195, 255, 127 }
 	);
+	FlightRecorder::get().count_rectangles();
 
 	for (auto &e : text) {
 		e.draw();
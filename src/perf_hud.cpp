@@ -0,0 +1,118 @@
+#include "perf_hud.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <iterator>
+
+#include "raylib.h"
+
+#include "globals.hpp"
+
+PerfHud::PerfHud() {
+	// shown by default in debug builds, as the fps graph it replaced was
+#ifdef DEBUG
+	visible = true;
+#else
+	visible = false;
+#endif
+
+	toggle_action = Action::TogglePerfHud.register_cb([this]() {
+		visible = !visible;
+	});
+}
+
+static int64_t micros(float millis) {
+	return std::lround(millis * 1000);
+}
+static int bucket_of(float millis) {
+	return std::min(int(millis / PerfHud::BUCKET_MS), PerfHud::BUCKETS - 1);
+}
+
+// adds (sign = 1) or removes (sign = -1) a frame
+void PerfHud::add(const FlightRecorder::Frame &frame, int64_t sign) {
+	histogram[bucket_of(frame.total)] += sign;
+	sums.update += sign * micros(frame.update);
+	sums.draw += sign * micros(frame.draw);
+	sums.present += sign * micros(frame.present);
+	sums.physics_ticks += sign * frame.physics_ticks;
+	sums.draw_calls += sign * frame.draw_calls;
+	sums.rectangles += sign * frame.rectangles;
+	sums.allocations += sign * frame.allocations;
+	sums.inputs += sign * frame.inputs;
+	sums.input_latency += sign * micros(frame.input_latency);
+}
+
+void PerfHud::update() {
+	const FlightRecorder &recorder = FlightRecorder::get();
+	const uint64_t count = recorder.frame_count();
+
+	// if too many frames were missed, the frames in the window can no
+	// longer be looked up to be removed, so start over
+	if (count - first > FlightRecorder::CAPACITY) {
+		std::fill(std::begin(histogram), std::end(histogram), 0);
+		sums = {};
+		first = next = count > WINDOW ? count - WINDOW : 0;
+	}
+
+	for (; next < count; ++next) {
+		add(recorder.frame(next), 1);
+		if (next - first >= WINDOW) add(recorder.frame(first++), -1);
+	}
+}
+
+float PerfHud::percentile(float p) const {
+	const uint64_t frames = next - first;
+	const uint64_t rank = std::max<uint64_t>(std::ceil(p * frames), 1);
+	uint64_t seen = 0;
+	for (int i = 0; i < BUCKETS; ++i) {
+		seen += histogram[i];
+		if (seen >= rank) return (i + 1) * BUCKET_MS;
+	}
+	return BUCKETS * BUCKET_MS;
+}
+
+void PerfHud::draw() const {
+	if (!visible || next == first) return;
+
+	const float frames = next - first;
+	const float p50 = percentile(0.50f);
+	const float p95 = percentile(0.95f);
+	const float p99 = percentile(0.99f);
+	// the last bucket also has all the slower frames in it
+	const char *const over = p99 >= BUCKETS * BUCKET_MS ? ">" : "";
+
+	// formatted into fixed buffers rather than strings, so that showing
+	// the HUD doesn't allocate
+	char lines[6][96];
+	std::snprintf(lines[0], sizeof(lines[0]), "frame   p50 %.2f  p95 %.2f  p99 %s%.2f ms",
+		p50, p95, over, p99);
+	std::snprintf(lines[1], sizeof(lines[1]), "update %.2f  draw %.2f  present %.2f ms",
+		sums.update / frames / 1000, sums.draw / frames / 1000, sums.present / frames / 1000);
+	std::snprintf(lines[2], sizeof(lines[2]), "physics ticks %.2f / frame",
+		sums.physics_ticks / frames);
+	std::snprintf(lines[3], sizeof(lines[3]), "draw calls %.0f  rects %.0f / frame",
+		sums.draw_calls / frames, sums.rectangles / frames);
+	std::snprintf(lines[4], sizeof(lines[4]), "allocations %.2f / frame",
+		sums.allocations / frames);
+	if (sums.inputs > 0) {
+		std::snprintf(lines[5], sizeof(lines[5]), "input latency %.2f ms (%d presses)",
+			float(sums.input_latency) / sums.inputs / 1000, int(sums.inputs));
+	} else {
+		std::snprintf(lines[5], sizeof(lines[5]), "input latency - (no presses)");
+	}
+
+	const int line_height = 10;
+	const int margin = 10;
+	const int padding = 4;
+	int width = 0;
+	for (const auto &line : lines) width = std::max(width, MeasureText(line, line_height));
+
+	const int height = 6*line_height + 5*padding;
+	const int x = margin;
+	const int y = global::WINDOW_HEIGHT - margin - height;
+	DrawRectangle(x - padding, y - padding, width + 2*padding, height + 2*padding, { 0, 0, 0, 160 });
+	for (int i = 0; i < 6; ++i) {
+		DrawText(lines[i], x, y + i*(line_height + padding), line_height, GREEN);
+	}
+}
@@ -1,9 +1,16 @@
 #include "player.hpp"
 
 #include <algorithm>
-
-#include "level.hpp"
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+
+#include "fixed.hpp"
+#include "flight_recorder.hpp"
+#include "globals.hpp"
+#include "profiler.hpp"
 #include "raylib.h"
+#include "simulation.hpp"
 #include "util.hpp"
 
 inline constexpr MotionInputs operator|(MotionInputs a, MotionInputs b) {
@@ -14,60 +21,145 @@ inline constexpr MotionInputs operator|(MotionInputs a, MotionInputs b) {
 inline constexpr MotionInputs &operator|=(MotionInputs &a, MotionInputs b) {
 	return a = a | b;
 }
+inline constexpr MotionInputs &operator&=(MotionInputs &a, MotionInputs b) {
+	return a = static_cast<MotionInputs>(
+		static_cast<uint8_t>(a) & static_cast<uint8_t>(b)
+	);
+}
+inline constexpr MotionInputs operator~(MotionInputs a) {
+	return static_cast<MotionInputs>(~static_cast<uint8_t>(a));
+}
+inline constexpr bool is_one_shot(MotionInputs input) {
+	return input == MotionInputs::DoubleJump || input == MotionInputs::Suicide;
+}
 inline constexpr bool test_input(MotionInputs mask, MotionInputs input) {
 	return (static_cast<uint8_t>(mask) & static_cast<uint8_t>(input)) != 0;
 }
 
-static constexpr float EPS = 1.0f / 1024;
+using std::abs; // util::Fixed has its own abs
 
-Player::Player(Stats &stats) : stats(stats) {
-	jump_action = Action::Jump.register_cb([this](float) {
-		inputs |= MotionInputs::Jump;
-	});
+static constexpr Scalar EPS = Scalar(1.0f / 1024);
+
+Player::Player(Stats &stats) : stats(stats) { }
+
+PlayerControls::PlayerControls() {
+	// the inputs already held down when the level starts count too
+	const auto held_initially = [this](const ActionStartStop &action, MotionInputs input) {
+		if (action.is_active()) held |= input;
+	};
+	held_initially(Action::Jump, MotionInputs::Jump);
+	held_initially(Action::Left, MotionInputs::WalkLeft);
+	held_initially(Action::Right, MotionInputs::WalkRight);
+	held_initially(Action::Slam, MotionInputs::Slam);
+	#ifdef DEBUG
+	held_initially(Action::Fly, MotionInputs::Fly);
+	#endif
+
+	jump_action = Action::Jump.register_cb(
+		[this]() { push(MotionInputs::Jump, true); },
+		[this]() { push(MotionInputs::Jump, false); }
+	);
 	double_jump_action = Action::DoubleJump.register_cb([this]() {
-		inputs |= MotionInputs::DoubleJump;
-	});
-	walk_left_action = Action::Left.register_cb([this](float) {
-		inputs |= MotionInputs::WalkLeft;
-	});
-	walk_right_action = Action::Right.register_cb([this](float) {
-		inputs |= MotionInputs::WalkRight;
+		push(MotionInputs::DoubleJump, true);
 	});
+	walk_left_action = Action::Left.register_cb(
+		[this]() { push(MotionInputs::WalkLeft, true); },
+		[this]() { push(MotionInputs::WalkLeft, false); }
+	);
+	walk_right_action = Action::Right.register_cb(
+		[this]() { push(MotionInputs::WalkRight, true); },
+		[this]() { push(MotionInputs::WalkRight, false); }
+	);
 	#ifdef DEBUG
-	fly_action = Action::Fly.register_cb([this](float) {
-		inputs |= MotionInputs::Fly;
-	});
+	fly_action = Action::Fly.register_cb(
+		[this]() { push(MotionInputs::Fly, true); },
+		[this]() { push(MotionInputs::Fly, false); }
+	);
 	#endif
 	suicide_action = Action::Suicide.register_cb([this]() {
-		if (!killed) ++this->stats.deaths;
-		killed = true;
-	});
-	slam_action = Action::Slam.register_cb([this](float) {
-		inputs |= MotionInputs::Slam;
+		push(MotionInputs::Suicide, true);
 	});
+	slam_action = Action::Slam.register_cb(
+		[this]() { push(MotionInputs::Slam, true); },
+		[this]() { push(MotionInputs::Slam, false); }
+	);
 }
+void PlayerControls::push(MotionInputs input, bool pressed) {
+	// can only happen if the ticks stall for a while; the events queued
+	// are then applied early (so none are lost), without timing them
+	if (queued == QUEUE_CAPACITY) apply_queued({});
 
-bool Player::on_ground(Level &level) {
+	queue[queued++] = { input, pressed, GetTime() };
+}
+void PlayerControls::apply_queued(on_press_t on_press) {
+	for (size_t i = 0; i < queued; ++i) {
+		const InputEvent &event = queue[i];
+		if (event.pressed) {
+			// one-shot inputs (double jump, suicide) are never released
+			if (!is_one_shot(event.input)) held |= event.input;
+			pressed |= event.input;
+			if (on_press) on_press(event.input, event.time);
+		} else {
+			held &= ~event.input;
+		}
+	}
+	queued = 0;
+}
+MotionInputs PlayerControls::take(on_press_t on_press) {
+	apply_queued(on_press);
+	const auto res = held | pressed;
+	pressed = MotionInputs::None;
+	return res;
+}
+void PlayerControls::clear() {
+	apply_queued({});
+	pressed = MotionInputs::None;
+}
+
+Player::Snapshot Player::snapshot() const {
+	return {
+		prev_pos, pos, vel, jumpstate, coyote_frames_left,
+		killed, level_completed,
+	};
+}
+void Player::restore(const Snapshot &snapshot) {
+	prev_pos = snapshot.prev_pos;
+	pos = snapshot.pos;
+	vel = snapshot.vel;
+	jumpstate = snapshot.jumpstate;
+	coyote_frames_left = snapshot.coyote_frames_left;
+	killed = snapshot.killed;
+	level_completed = snapshot.level_completed;
+}
+
+void Player::hash_state(util::Hash &hash) const {
+	hash.add_word(util::bits(pos.x) | uint64_t(util::bits(pos.y)) << 32);
+	hash.add_word(util::bits(vel.x) | uint64_t(util::bits(vel.y)) << 32);
+	hash.add_word(uint64_t(jumpstate) | uint64_t(uint32_t(coyote_frames_left)) << 32);
+	hash.add_word(uint64_t(killed) | uint64_t(level_completed) << 1);
+}
+
+bool Player::on_ground(const Simulation &sim) const {
 	if (pos.y >= 0) return true;
 
 	for (int dx = -1; dx <= 1; ++dx) {
-		const Vector2 check_point = {
+		const Vec2 check_point = {
 			pos.x + dx,
-			pos.y + 0.5f,
+			pos.y + Scalar(0.5f),
 		};
-		const auto collider = level.get_collider(check_point.x, check_point.y);
+		const auto collider = sim.get_collider(check_point.x, check_point.y);
 
 		if (collider.width == 0 && collider.height == 0) continue;
 		if (collider.x >= pos.x + size.x/2 || collider.x + collider.width <= pos.x - size.x/2) continue;
 
-		const TileType type = level.get_tile(check_point.x, check_point.y).type;
+		const TileType type = sim.get_tile(check_point.x, check_point.y).type;
 
 		if (type != TileType::Solid) continue;
 
 		if (collider.y == pos.y) return true;
 
-		const float bottom_dist_near = collider.y - pos.y;
-		const float bottom_dist_far = (collider.y + collider.height) - pos.y;
+		const Scalar bottom_dist_near = collider.y - pos.y;
+		const Scalar bottom_dist_far = (collider.y + collider.height) - pos.y;
 
 		const bool inside_bottom = bottom_dist_near <= 0 && bottom_dist_far >= 0;
 
@@ -80,112 +172,112 @@ bool Player::test_input(MotionInputs input) {
 	return ::test_input(inputs, input);
 }
 
-void Player::resolve_collisions_x(Level &level) {
-	const Rectangle player_collider = {
+void Player::resolve_collisions_x(Simulation &sim) {
+	const Rect player_collider = {
 		pos.x - size.x/2, pos.y - size.y,
 		size.x, size.y
 	};
 
-	for (int dy = -2; dy <= 1; ++dy) {
-		for (int dx = -1; dx <= 1; ++dx) {
-			const Vector2 check_point = {
-				pos.x + dx,
-				pos.y - 0.5f + dy,
-			};
-			const auto collider = level.get_collider(check_point.x, check_point.y);
-			const auto tile = level.get_tile(check_point.x, check_point.y);
-
-			if (tile.type == TileType::Empty) continue;
-			if (collider.width == 0 && collider.height == 0) continue;
-
-			const auto collision = util::collide(player_collider, collider);
-
-			// if there is no x collision, or if the player only
-			// slightly overlaps with the block in the y axis,
-			// no work to be done
-			const bool x_inside = collision.x_touches && collision.dist.x != 0;
-			if (!x_inside || std::abs(collision.dist.y) <= EPS) continue;
-
-			switch (tile.type) {
-				case TileType::Solid: if (std::abs(collision.dist.x) >= EPS) {
-					pos.x = collision.new_pos.x + size.x/2;
-					if (collision.dist.x < 0 && vel.x > 0) {
-						vel.x *= -tile.bounce.side;
-					}
-					if (collision.dist.x > 0 && vel.x < 0) {
-						vel.x = -tile.bounce.side;
-					}
-				} break;
-				case TileType::Danger: {
-					if (!killed) ++stats.deaths;
-					killed = true;
-				} break;
-				case TileType::Goal: {
-					level_completed = true;
-				} break;
-				case TileType::Empty: break;
-				case TileType::Checkpoint: {
-					level.activate_checkpoint(check_point.x, check_point.y);
-				} break;
-			}
+	// the tiles within one tile of the player, merged into as few
+	// colliders as possible
+	Simulation::Collider colliders[Simulation::MAX_COLLIDERS];
+	const size_t collider_count = sim.get_colliders(
+		{ pos.x - 1, pos.y - Scalar(2.5f) }, { pos.x + 1, pos.y + Scalar(0.5f) },
+		colliders, Simulation::MAX_COLLIDERS
+	);
+
+	for (size_t i = 0; i < collider_count; ++i) {
+		const Rect collider = colliders[i].rect;
+		const Tile &tile = *colliders[i].tile;
+
+		const auto collision = util::collide(player_collider, collider);
+
+		// if there is no x collision, or if the player only
+		// slightly overlaps with the block in the y axis,
+		// no work to be done
+		const bool x_inside = collision.x_touches && collision.dist.x != 0;
+		if (!x_inside || abs(collision.dist.y) <= EPS) continue;
+
+		switch (tile.type) {
+			case TileType::Solid: if (abs(collision.dist.x) >= EPS) {
+				pos.x = collision.new_pos.x + size.x/2;
+				if (collision.dist.x < 0 && vel.x > 0) {
+					vel.x *= -Scalar(tile.bounce.side);
+				}
+				if (collision.dist.x > 0 && vel.x < 0) {
+					vel.x = -Scalar(tile.bounce.side);
+				}
+			} break;
+			case TileType::Danger: {
+				if (!killed) ++stats.deaths;
+				killed = true;
+			} break;
+			case TileType::Goal: {
+				level_completed = true;
+			} break;
+			case TileType::Empty: break;
+			case TileType::Checkpoint: {
+				sim.activate_checkpoint(collider.x + Scalar(0.5f), collider.y + Scalar(0.5f));
+			} break;
 		}
 	}
 }
-void Player::resolve_collisions_y(Level &level) {
+void Player::resolve_collisions_y(Simulation &sim) {
 	if (pos.y > 0) pos.y = 0;
 
-	const Rectangle player_collider = {
+	const Rect player_collider = {
 		pos.x - size.x/2, pos.y - size.y,
 		size.x, size.y
 	};
 
-	for (int dy = -2; dy <= 1; ++dy) {
-		for (int dx = -1; dx <= 1; ++dx) {
-			const Vector2 check_point = {
-				pos.x + dx,
-				pos.y - 0.5f + dy,
-			};
-			const auto collider = level.get_collider(check_point.x, check_point.y);
-			const auto tile = level.get_tile(check_point.x, check_point.y);
-
-			if (tile.type == TileType::Empty) continue;
-			if (collider.width == 0 && collider.height == 0) continue;
-
-			const auto collision = util::collide(player_collider, collider);
-
-			// if there is no y collision, or if the player only
-			// slightly overlaps with the block in the x axis,
-			// no work to be done
-			const bool y_inside = collision.y_touches && collision.dist.y != 0;
-			if (!y_inside || std::abs(collision.dist.x) <= EPS) continue;
-
-			switch (tile.type) {
-				case TileType::Solid: if (std::abs(collision.dist.y) >= EPS) {
-					pos.y = collision.new_pos.y + size.y;
-					if (collision.dist.y < 0 && vel.y > 0) {
-						vel.y *= -tile.bounce.top;
-					}
-					if (collision.dist.y > 0 && vel.y < 0) {
-						vel.y *= -tile.bounce.bottom;
-					}
-				} break;
-				case TileType::Danger: {
-					if (!killed) ++stats.deaths;
-					killed = true;
-				} break;
-				case TileType::Goal: {
-					level_completed = true;
-				} break;
-				case TileType::Empty: break;
-				case TileType::Checkpoint: {
-					level.activate_checkpoint(check_point.x, check_point.y);
-				} break;
-			}
+	// the tiles within one tile of the player, merged into as few
+	// colliders as possible
+	Simulation::Collider colliders[Simulation::MAX_COLLIDERS];
+	const size_t collider_count = sim.get_colliders(
+		{ pos.x - 1, pos.y - Scalar(2.5f) }, { pos.x + 1, pos.y + Scalar(0.5f) },
+		colliders, Simulation::MAX_COLLIDERS
+	);
+
+	for (size_t i = 0; i < collider_count; ++i) {
+		const Rect collider = colliders[i].rect;
+		const Tile &tile = *colliders[i].tile;
+
+		const auto collision = util::collide(player_collider, collider);
+
+		// if there is no y collision, or if the player only
+		// slightly overlaps with the block in the x axis,
+		// no work to be done
+		const bool y_inside = collision.y_touches && collision.dist.y != 0;
+		if (!y_inside || abs(collision.dist.x) <= EPS) continue;
+
+		switch (tile.type) {
+			case TileType::Solid: if (abs(collision.dist.y) >= EPS) {
+				pos.y = collision.new_pos.y + size.y;
+				if (collision.dist.y < 0 && vel.y > 0) {
+					vel.y *= -Scalar(tile.bounce.top);
+				}
+				if (collision.dist.y > 0 && vel.y < 0) {
+					vel.y *= -Scalar(tile.bounce.bottom);
+				}
+			} break;
+			case TileType::Danger: {
+				if (!killed) ++stats.deaths;
+				killed = true;
+			} break;
+			case TileType::Goal: {
+				level_completed = true;
+			} break;
+			case TileType::Empty: break;
+			case TileType::Checkpoint: {
+				sim.activate_checkpoint(collider.x + Scalar(0.5f), collider.y + Scalar(0.5f));
+			} break;
 		}
 	}
 }
 
 Vector2 Player::get_pos(float interp) const {
+	const Vector2 prev_pos = to_vector2(this->prev_pos);
+	const Vector2 pos = to_vector2(this->pos);
 	if (interp <= 0) return prev_pos;
 	if (interp >= 1) return pos;
 	return {
@@ -193,34 +285,40 @@ Vector2 Player::get_pos(float interp) const {
 		prev_pos.y*(1 - interp) + pos.y*interp,
 	};
 }
-void Player::spawn(Vector2 pos) {
+void Player::spawn(Vec2 pos) {
 	this->pos = pos;
 	this->prev_pos = pos;
 	this->vel = { 0, 0 };
 	this->inputs = MotionInputs::None;
 	this->jumpstate = JumpState::DoubleJumped;
+	this->coyote_frames_left = 0;
 
 	killed = false;
 	level_completed = false;
 }
 
-void Player::update(Level &level) {
-	static int coyote_frames_left = 0;
-
-	const float dt = 1.0f / global::PHYSICS_FPS;
+void Player::update(Simulation &sim, MotionInputs tick_inputs) {
+	PROFILE_ZONE("Player::update");
+	const Scalar dt = sim.get_dt();
+	const int coyote_ticks = std::lround(coyote_time * sim.get_tick_rate());
 
+	inputs = tick_inputs;
 	prev_pos = pos;
 
+	if (test_input(MotionInputs::Suicide)) {
+		if (!killed) ++stats.deaths;
+		killed = true;
+	}
 	if (killed) {
-		level.respawn_player(); return;
+		sim.respawn_player(); return;
 	}
 	if (level_completed) {
-		level.display_win_overlay(); return;
+		sim.complete(); return;
 	}
 
-	if (on_ground(level)) {
+	if (on_ground(sim)) {
 		jumpstate = JumpState::Grounded;
-		coyote_frames_left = coyote_frames;
+		coyote_frames_left = coyote_ticks;
 	} else if (jumpstate == JumpState::Grounded) {
 		if (coyote_frames_left <= 0) jumpstate = JumpState::Airborne;
 		else --coyote_frames_left;
@@ -260,74 +358,78 @@ void Player::update(Level &level) {
 	}
 	#ifdef DEBUG
 	if (test_input(MotionInputs::Fly)) {
-		vel.y = std::min(vel.y, -jump_vel / 2.0f);
+		vel.y = std::min(vel.y, -jump_vel / 2);
 	}
 	#endif
 
 	if (jumpstate == JumpState::Grounded) {
-		vel.y = std::min(0.f, vel.y);
+		vel.y = std::min(Scalar(0), vel.y);
 
 		if (!test_input(MotionInputs::WalkLeft | MotionInputs::WalkRight)) {
-			const float below_y = pos.y + 0.5f;
-			const float below_centre = pos.x;
-			const float below_left = pos.x - size.x/2;
-			const float below_right = pos.x + size.x/2;
-			const float friction = std::max(std::max(
-				level.get_tile(below_centre, below_y).friction,
-				level.get_tile(below_left, below_y).friction
-			), level.get_tile(below_right, below_y).friction
-			);
-
-			if (friction * dt >= std::abs(vel.x)) vel.x = 0;
+			const Scalar below_y = pos.y + Scalar(0.5f);
+			const Scalar below_centre = pos.x;
+			const Scalar below_left = pos.x - size.x/2;
+			const Scalar below_right = pos.x + size.x/2;
+			const Scalar friction = Scalar(std::max(std::max(
+				sim.get_tile(below_centre, below_y).friction,
+				sim.get_tile(below_left, below_y).friction
+			), sim.get_tile(below_right, below_y).friction
+			));
+
+			if (friction * dt >= abs(vel.x)) vel.x = 0;
 			else if (vel.x > 0) vel.x -= friction * dt;
 			else vel.x += friction * dt;
 		}
 	} else {
 		#ifdef DEBUG
 		if (!test_input(MotionInputs::Fly)) {
-			const float scale = jumpstate == JumpState::Slamming ? 2.0f : 1.0f;
-			vel.y += level.gravity * scale * dt;
+			const Scalar scale = jumpstate == JumpState::Slamming ? 2 : 1;
+			vel.y += sim.gravity * scale * dt;
 		}
 		#else
-		const float scale = jumpstate == JumpState::Slamming ? 2.0f : 1.0f;
-		vel.y += level.gravity * scale * dt;
+		const Scalar scale = jumpstate == JumpState::Slamming ? 2 : 1;
+		vel.y += sim.gravity * scale * dt;
 		#endif
 	}
 
-	if (std::abs(vel.y) <= std::abs(vel.x)) {
+	if (abs(vel.y) <= abs(vel.x)) {
 		pos.x += vel.x * dt;
-		resolve_collisions_x(level);
+		resolve_collisions_x(sim);
 
 		pos.y += vel.y * dt;
-		resolve_collisions_y(level);
+		resolve_collisions_y(sim);
 	} else {
 		pos.y += vel.y * dt;
-		resolve_collisions_y(level);
+		resolve_collisions_y(sim);
 
 		pos.x += vel.x * dt;
-		resolve_collisions_x(level);
+		resolve_collisions_x(sim);
 	}
 
-	inputs = MotionInputs::None;
-
-	if (killed) level.respawn_player();
-	if (level_completed) level.display_win_overlay();
+	if (killed) sim.respawn_player();
+	if (level_completed) sim.complete();
 }
 void Player::draw(float interp) const {
 	const auto visual_pos = get_pos(interp);
+	const Vector2 size = to_vector2(this->size);
 	DrawRectangleV(
 		Vector2{ visual_pos.x - size.x/2, visual_pos.y - size.y },
 		size,
 		BLACK
 	);
+	FlightRecorder::get().count_rectangles();
 #ifdef DEBUG
-	const std::string y_vel = std::to_string(int(vel.y));
-	const std::string x_vel = std::to_string(int(vel.x));
-	const auto y_width = MeasureTextEx(GetFontDefault(), y_vel.c_str(), 1, .1);
-	const auto x_width = MeasureTextEx(GetFontDefault(), y_vel.c_str(), 1, .1);
-	DrawTextEx(GetFontDefault(), x_vel.c_str(), { visual_pos.x - y_width.x/2, visual_pos.y - size.y - 1.25f }, 1, .1, BLACK);
-	DrawTextEx(GetFontDefault(), y_vel.c_str(), { visual_pos.x - x_width.x/2, visual_pos.y - size.y - 2.5f }, 1, .1, BLACK);
-
+	char y_vel[16], x_vel[16];
+	std::snprintf(y_vel, sizeof(y_vel), "%d", int(vel.y));
+	std::snprintf(x_vel, sizeof(x_vel), "%d", int(vel.x));
+	const auto y_width = MeasureTextEx(GetFontDefault(), y_vel, 1, .1);
+	const auto x_width = MeasureTextEx(GetFontDefault(), y_vel, 1, .1);
+	DrawTextEx(GetFontDefault(), x_vel, { visual_pos.x - y_width.x/2, visual_pos.y - size.y - 1.25f }, 1, .1, BLACK);
+	DrawTextEx(GetFontDefault(), y_vel, { visual_pos.x - x_width.x/2, visual_pos.y - size.y - 2.5f }, 1, .1, BLACK);
+
+	const Vector2 pos = to_vector2(this->pos);
 	DrawRectangleLinesEx({ pos.x - size.x/2, pos.y - size.y, size.x, size.y }, 1/16.f, GREEN);
+	FlightRecorder::get().count_draw_calls(2);
+	FlightRecorder::get().count_rectangles();
 #endif
 }
@@ -0,0 +1,145 @@
+#include "profiler.hpp"
+
+#ifdef DEBUG
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace profiler {
+
+namespace {
+
+struct Event {
+	// atomic so that exporting from another thread while the zones are
+	// being recorded is well-defined; relaxed atomic loads and stores are
+	// plain loads and stores on x86 and ARM anyway
+	std::atomic<const char *> name;
+	std::atomic<uint64_t> start;
+	std::atomic<uint64_t> end;
+};
+
+// a single-producer ring buffer, written to only by its own thread
+struct ThreadBuffer {
+	static constexpr uint64_t CAPACITY = 1 << 16;
+	static constexpr uint64_t MASK = CAPACITY - 1;
+
+	uint32_t thread_id;
+	// the number of zones ever recorded; the most recent CAPACITY of them
+	// are in events[i & MASK]
+	std::atomic<uint64_t> head = 0;
+	// head, but updated before rather than after an event is written (as
+	// in a seqlock), so that a reader can tell which of the events it read
+	// might have been overwritten in the meantime
+	std::atomic<uint64_t> claimed = 0;
+	Event events[CAPACITY];
+};
+
+// every thread that has ever recorded a zone has its buffer here, which is
+// kept around after the thread exits so that its zones can still be exported
+std::mutex buffers_mutex;
+std::vector<std::unique_ptr<ThreadBuffer>> buffers;
+
+ThreadBuffer &thread_buffer() {
+	// only the first zone of each thread takes the lock
+	thread_local ThreadBuffer *buffer = [] {
+		const std::lock_guard<std::mutex> lock(buffers_mutex);
+		buffers.push_back(std::make_unique<ThreadBuffer>());
+		buffers.back()->thread_id = buffers.size() - 1;
+		return buffers.back().get();
+	}();
+	return *buffer;
+}
+
+const auto epoch = std::chrono::steady_clock::now();
+// nanoseconds since the program started
+uint64_t now() {
+	return std::chrono::duration_cast<std::chrono::nanoseconds>(
+		std::chrono::steady_clock::now() - epoch
+	).count();
+}
+
+}
+
+Zone::Zone(const char *name) : name(name), start(now()) { }
+Zone::~Zone() {
+	const uint64_t end = now();
+
+	ThreadBuffer &buffer = thread_buffer();
+	const uint64_t head = buffer.head.load(std::memory_order_relaxed);
+	buffer.claimed.store(head + 1, std::memory_order_relaxed);
+	std::atomic_thread_fence(std::memory_order_release);
+	Event &event = buffer.events[head & ThreadBuffer::MASK];
+	event.name.store(name, std::memory_order_relaxed);
+	event.start.store(start, std::memory_order_relaxed);
+	event.end.store(end, std::memory_order_relaxed);
+	// publishes the event to export_trace
+	buffer.head.store(head + 1, std::memory_order_release);
+}
+
+bool export_trace(const std::string &path) {
+	std::ofstream out(path);
+	if (!out) {
+		std::cerr << "Failed opening " << path << " for writing!" << std::endl;
+		return false;
+	}
+
+	// see https://docs.google.com/document/d/1CvAClvFfyA5R-PhYUmn5OOQtYMH4h6I0nSsKchNAySU
+	out << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n";
+	out << std::fixed << std::setprecision(3);
+	bool first = true;
+
+	const std::lock_guard<std::mutex> lock(buffers_mutex);
+	for (const auto &buffer : buffers) {
+		if (!first) out << ",\n";
+		first = false;
+		out << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":" << buffer->thread_id
+			<< ",\"args\":{\"name\":\"thread " << buffer->thread_id << "\"}}";
+
+		const uint64_t end = buffer->head.load(std::memory_order_acquire);
+		const uint64_t begin = end > ThreadBuffer::CAPACITY ? end - ThreadBuffer::CAPACITY : 0;
+		struct Copy { const char *name; uint64_t start, end; };
+		std::vector<Copy> events;
+		events.reserve(end - begin);
+		for (uint64_t i = begin; i < end; ++i) {
+			const Event &event = buffer->events[i & ThreadBuffer::MASK];
+			events.push_back({
+				event.name.load(std::memory_order_relaxed),
+				event.start.load(std::memory_order_relaxed),
+				event.end.load(std::memory_order_relaxed),
+			});
+		}
+		// the thread may have kept on recording while the events were
+		// copied, and overwritten some of the oldest ones
+		std::atomic_thread_fence(std::memory_order_acquire);
+		const uint64_t claimed = buffer->claimed.load(std::memory_order_relaxed);
+		const uint64_t valid = claimed > ThreadBuffer::CAPACITY ? claimed - ThreadBuffer::CAPACITY : 0;
+
+		for (uint64_t i = std::max(begin, valid); i < end; ++i) {
+			const Copy &event = events[i - begin];
+			out << ",\n{\"name\":\"" << event.name << "\",\"ph\":\"X\",\"pid\":1,\"tid\":" << buffer->thread_id
+				<< ",\"ts\":" << event.start / 1000.0
+				<< ",\"dur\":" << (event.end - event.start) / 1000.0 << "}";
+		}
+	}
+	out << "\n]}\n";
+
+	out.close();
+	if (!out) {
+		std::cerr << "Failed writing " << path << "!" << std::endl;
+		return false;
+	}
+	return true;
+}
+
+}
+
+#endif /* DEBUG */
@@ -0,0 +1,304 @@
+#include "replay.hpp"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <memory>
+#include <optional>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "globals.hpp"
+#include "level_data.hpp"
+#include "player.hpp"
+#include "simulation.hpp"
+#include "stats.hpp"
+#include "util.hpp"
+
+Replay::Replay(size_t level_nr, const LevelData &data, bool with_hashes)
+: with_hashes(with_hashes), level_nr(level_nr),
+  content_hash(data.content_hash), build_id(current_build_id())
+{ }
+
+uint64_t Replay::current_build_id() {
+	util::Hash hash;
+	hash.add(PHYSICS_REVISION);
+	hash.add(global::PHYSICS_FPS);
+	#ifdef FLOAT_PHYSICS
+	// floating point results may differ between compilers and versions,
+	// while fixed point results are the same everywhere
+	hash.add(true);
+	#ifdef __VERSION__
+	hash.add_bytes(__VERSION__, sizeof(__VERSION__));
+	#endif
+	#else
+	hash.add(false);
+	#endif
+	#ifdef DEBUG
+	// debug builds have extra inputs (flying)
+	hash.add(true);
+	#else
+	hash.add(false);
+	#endif
+	return hash.value;
+}
+
+void Replay::reserve(uint32_t ticks, size_t runs) {
+	this->runs.reserve(runs);
+	latencies.reserve(runs);
+	if (with_hashes) hashes.reserve(ticks);
+}
+void Replay::record(MotionInputs inputs) {
+	++ticks;
+	if (!runs.empty() && runs.back().inputs == inputs) {
+		++runs.back().length;
+	} else {
+		runs.push_back({ inputs, 1 });
+	}
+	if (with_hashes) hashes.push_back(0);
+}
+void Replay::record_hash(uint64_t hash) {
+	hashes.back() = hash;
+}
+void Replay::record_latency(MotionInputs input, uint32_t micros) {
+	latencies.push_back({ ticks, micros, input, {} });
+}
+void Replay::truncate(uint32_t ticks) {
+	while (!latencies.empty() && latencies.back().tick >= ticks) latencies.pop_back();
+	if (ticks >= this->ticks) return;
+
+	uint32_t kept = 0;
+	size_t i = 0;
+	while (kept + runs[i].length < ticks) {
+		kept += runs[i].length;
+		++i;
+	}
+	if (kept == ticks) {
+		runs.resize(i);
+	} else {
+		runs[i].length = ticks - kept;
+		runs.resize(i + 1);
+	}
+	if (with_hashes) hashes.resize(ticks);
+	this->ticks = ticks;
+}
+
+std::string Replay::path_for(size_t level_nr) {
+	std::string res;
+	res += global::DATA_DIR;
+	res += global::REPLAYS_DIR;
+	res += pb_key(std::to_string(level_nr));
+	res += ".rpl";
+	return res;
+}
+
+std::optional<Replay> Replay::load(const std::string &path) {
+	std::ifstream in(path, std::ios::binary);
+	if (!in) return {};
+	const std::vector<unsigned char> file(
+		(std::istreambuf_iterator<char>(in)),
+		std::istreambuf_iterator<char>()
+	);
+
+	Header header;
+	if (file.size() < sizeof(header)) {
+		std::cerr << "WARN: replay " << path << " is truncated" << std::endl;
+		return {};
+	}
+	std::memcpy(&header, file.data(), sizeof(header));
+	if (std::memcmp(header.magic, MAGIC, sizeof(MAGIC)) != 0) {
+		std::cerr << "WARN: " << path << " is not a replay" << std::endl;
+		return {};
+	}
+	if (header.version < MIN_VERSION || header.version > VERSION) {
+		std::cerr << "WARN: replay " << path << " has version " << header.version << ", expected " << MIN_VERSION << " to " << VERSION << std::endl;
+		return {};
+	}
+	const bool valid = (header.hash_count == 0 || header.hash_count == header.ticks)
+		&& header.data_len + uint64_t(header.hash_count)*sizeof(uint64_t)
+			+ uint64_t(header.latency_count)*sizeof(Latency) == file.size() - sizeof(header);
+	if (!valid) {
+		std::cerr << "WARN: replay " << path << " is corrupt" << std::endl;
+		return {};
+	}
+
+	Replay res;
+	res.level_nr = header.level_nr;
+	res.content_hash = header.content_hash;
+	res.build_id = header.build_id;
+	res.stats = {
+		header.time, header.jumps, header.double_jumps,
+		header.deaths, header.restarts,
+	};
+
+	const unsigned char *pos = file.data() + sizeof(header);
+	const unsigned char *const end = file.data() + sizeof(header) + header.data_len;
+	while (pos != end) {
+		const auto inputs = MotionInputs(*pos++);
+
+		uint64_t length = 0;
+		for (int shift = 0; ; shift += 7) {
+			if (pos == end || shift > 28) {
+				std::cerr << "WARN: replay " << path << " is corrupt" << std::endl;
+				return {};
+			}
+			length |= uint64_t(*pos & 0x7f) << shift;
+			if ((*pos++ & 0x80) == 0) break;
+		}
+		if (length == 0 || res.ticks + length > header.ticks) {
+			std::cerr << "WARN: replay " << path << " is corrupt" << std::endl;
+			return {};
+		}
+
+		res.runs.push_back({ inputs, uint32_t(length) });
+		res.ticks += length;
+	}
+	if (res.ticks != header.ticks) {
+		std::cerr << "WARN: replay " << path << " is corrupt" << std::endl;
+		return {};
+	}
+
+	res.with_hashes = header.hash_count != 0;
+	res.hashes.resize(header.hash_count);
+	std::memcpy(res.hashes.data(), end, header.hash_count*sizeof(uint64_t));
+
+	res.latencies.resize(header.latency_count);
+	std::memcpy(
+		res.latencies.data(), end + header.hash_count*sizeof(uint64_t),
+		header.latency_count*sizeof(Latency)
+	);
+	for (size_t i = 0; i < res.latencies.size(); ++i) {
+		const uint32_t tick = res.latencies[i].tick;
+		if (tick >= res.ticks || (i > 0 && tick < res.latencies[i - 1].tick)) {
+			std::cerr << "WARN: replay " << path << " is corrupt" << std::endl;
+			return {};
+		}
+	}
+
+	return res;
+}
+
+bool Replay::save(const std::string &path) const {
+	std::vector<unsigned char> data;
+	for (const auto &run : runs) {
+		data.push_back(static_cast<unsigned char>(run.inputs));
+		uint32_t length = run.length;
+		while (length >= 0x80) {
+			data.push_back((length & 0x7f) | 0x80);
+			length >>= 7;
+		}
+		data.push_back(length);
+	}
+
+	// zero the padding bytes too, so that saving is reproducible
+	Header header;
+	std::memset(&header, 0, sizeof(header));
+	std::memcpy(header.magic, MAGIC, sizeof(MAGIC));
+	header.version = VERSION;
+	header.level_nr = level_nr;
+	header.content_hash = content_hash;
+	header.build_id = build_id;
+	header.time = stats.time;
+	header.jumps = stats.jumps;
+	header.double_jumps = stats.double_jumps;
+	header.deaths = stats.deaths;
+	header.restarts = stats.restarts;
+	header.ticks = ticks;
+	header.data_len = data.size();
+	header.hash_count = hashes.size();
+	header.latency_count = latencies.size();
+
+	const auto dir = std::filesystem::path(path).parent_path();
+	std::error_code ec;
+	if (!dir.empty() && !std::filesystem::exists(dir, ec)) {
+		if (!std::filesystem::create_directories(dir, ec)) {
+			std::cerr << "Failed creating replay folder " << dir << "!" << std::endl;
+			return false;
+		}
+	}
+
+	// written to a temporary file first and renamed over the old replay,
+	// so that a crash or a full disk while writing leaves the old replay
+	// (eg. the previous personal best's) rather than a truncated one
+	const std::string tmp_path = path + ".tmp";
+	std::ofstream out(tmp_path, std::ios::binary);
+	if (!out) {
+		std::cerr << "Failed opening " << tmp_path << " for writing!" << std::endl;
+		return false;
+	}
+	out.write(reinterpret_cast<const char *>(&header), sizeof(header));
+	out.write(reinterpret_cast<const char *>(data.data()), data.size());
+	out.write(reinterpret_cast<const char *>(hashes.data()), hashes.size()*sizeof(uint64_t));
+	out.write(reinterpret_cast<const char *>(latencies.data()), latencies.size()*sizeof(Latency));
+	out.close();
+	if (!out) {
+		std::cerr << "Failed writing " << tmp_path << "!" << std::endl;
+		std::remove(tmp_path.c_str());
+		return false;
+	}
+
+	std::filesystem::rename(tmp_path, path, ec);
+	if (ec) {
+		std::cerr << "Failed renaming " << tmp_path << " to " << path << ": " << ec.message() << std::endl;
+		std::remove(tmp_path.c_str());
+		return false;
+	}
+	return true;
+}
+
+ReplayPlayer::ReplayPlayer(const Replay &replay, std::shared_ptr<const LevelData> data)
+: replay(replay), sim(std::move(data))
+{
+	keyframes.push_back({ sim.snapshot(), 0, 0 });
+}
+
+void ReplayPlayer::restore(const Keyframe &keyframe, uint32_t tick) {
+	sim.restore(keyframe.sim);
+	run_ix = keyframe.run_ix;
+	run_pos = keyframe.run_pos;
+	this->tick = tick;
+}
+
+bool ReplayPlayer::step() {
+	if (done()) return false;
+
+	const auto &run = replay.get_runs()[run_ix];
+	sim.tick(run.inputs);
+	++tick;
+	if (++run_pos == run.length) {
+		++run_ix;
+		run_pos = 0;
+	}
+
+	if (replay.has_hashes() && !desync.has_value()
+	    && sim.state_hash() != replay.get_hashes()[tick - 1]) {
+		desync = tick;
+	}
+
+	if (tick % KEYFRAME_INTERVAL == 0 && tick / KEYFRAME_INTERVAL == keyframes.size()) {
+		keyframes.push_back({ sim.snapshot(), run_ix, run_pos });
+	}
+	return true;
+}
+uint32_t ReplayPlayer::fast_forward(uint32_t ticks) {
+	uint32_t played = 0;
+	while (played < ticks && step()) ++played;
+	return played;
+}
+void ReplayPlayer::seek(uint32_t tick) {
+	if (tick > replay.length()) tick = replay.length();
+
+	// the furthest keyframe that doesn't pass the target, if it is of use
+	const size_t keyframe = std::min<size_t>(tick / KEYFRAME_INTERVAL, keyframes.size() - 1);
+	const uint32_t keyframe_tick = keyframe * KEYFRAME_INTERVAL;
+	if (tick < this->tick || keyframe_tick > this->tick) {
+		restore(keyframes[keyframe], keyframe_tick);
+	}
+
+	fast_forward(tick - this->tick);
+}
@@ -0,0 +1,137 @@
+#include "simulation.hpp"
+
+#include <algorithm>
+#include <cstdint>
+#include <memory>
+#include <utility>
+
+#include "raylib.h"
+
+#include "collider_mesh.hpp"
+#include "fixed.hpp"
+#include "globals.hpp"
+#include "level_data.hpp"
+#include "player.hpp"
+#include "profiler.hpp"
+#include "util.hpp"
+
+Simulation::Simulation(std::shared_ptr<const LevelData> data)
+: Simulation(std::move(data), global::PHYSICS_FPS)
+{ }
+Simulation::Simulation(std::shared_ptr<const LevelData> data, int tick_rate)
+: data(std::move(data)), tiles(this->data->tiles),
+  w(tiles.width()), h(tiles.height()),
+  tick_rate(tick_rate), dt(Scalar(1) / tick_rate),
+  offset(to_vec2(get_offset())),
+  player(stats),
+  player_spawn { this->data->spawn.x, h + this->data->spawn.y }
+{
+	player.spawn(to_vec2(get_player_spawn()));
+}
+
+void Simulation::tick(MotionInputs inputs) {
+	PROFILE_ZONE("Simulation::tick");
+	++stats.time;
+
+	player.update(*this, inputs);
+}
+
+Vector2 Simulation::get_offset() const {
+	return { -w/2.0f, -float(h) };
+}
+Vector2 Simulation::get_player_spawn() const {
+	const auto world_offset = get_offset();
+
+	return { player_spawn.x + world_offset.x + 0.5f, player_spawn.y + world_offset.y };
+}
+
+Simulation::Snapshot Simulation::snapshot() const {
+	return {
+		player.snapshot(), player_spawn, active_checkpoint, stats,
+		gravity, completed,
+	};
+}
+void Simulation::restore(const Snapshot &snapshot) {
+	player.restore(snapshot.player);
+	player_spawn = snapshot.player_spawn;
+	active_checkpoint = snapshot.active_checkpoint;
+	stats = snapshot.stats;
+	gravity = snapshot.gravity;
+	completed = snapshot.completed;
+}
+
+uint64_t Simulation::state_hash() const {
+	util::Hash hash;
+	player.hash_state(hash);
+
+	hash.add_word(util::bits(player_spawn.x) | uint64_t(util::bits(player_spawn.y)) << 32);
+	if (active_checkpoint.has_value()) {
+		hash.add_word(util::bits(active_checkpoint->x) | uint64_t(util::bits(active_checkpoint->y)) << 32);
+	} else {
+		hash.add_word(~uint64_t(0));
+	}
+
+	hash.add_word(stats.time | uint64_t(uint32_t(stats.deaths)) << 32);
+	hash.add_word(stats.jumps | uint64_t(stats.double_jumps) << 32);
+	hash.add_word(uint64_t(uint32_t(stats.restarts)) | uint64_t(completed) << 32);
+	return hash.value;
+}
+
+Rect Simulation::get_collider(Scalar x, Scalar y) const {
+	const int lvl_x = int(x - offset.x);
+	const int lvl_y = int(y - offset.y);
+	if (!tiles.in_bounds(lvl_x, lvl_y)) {
+		return { 0, 0, 0, 0 };
+	}
+	const auto &tile = tiles.at(lvl_x, lvl_y);
+	if (tile.type == TileType::Empty) {
+		return { 0, 0, 0, 0 };
+	}
+	return { lvl_x + offset.x, lvl_y + offset.y, 1, 1 };
+}
+size_t Simulation::get_colliders(Vec2 from, Vec2 to, Collider *out, size_t cap) const {
+	// converted to cells the same way as in get_collider
+	const int x0 = int(from.x - offset.x);
+	const int y0 = int(from.y - offset.y);
+	const int x1 = int(to.x - offset.x);
+	const int y1 = int(to.y - offset.y);
+
+	ColliderMesh::Collider cells[MAX_COLLIDERS];
+	const size_t count = data->colliders.query(
+		x0, y0, x1, y1, cells, std::min(cap, MAX_COLLIDERS)
+	);
+	const auto &palette = tiles.get_palette();
+	for (size_t i = 0; i < count; ++i) {
+		out[i] = {
+			{
+				cells[i].x + offset.x, cells[i].y + offset.y,
+				Scalar(cells[i].w), Scalar(cells[i].h),
+			},
+			&palette[cells[i].tile],
+		};
+	}
+	return count;
+}
+Tile Simulation::get_tile(Scalar x, Scalar y) const {
+	const int lvl_x = int(x - offset.x);
+	const int lvl_y = int(y - offset.y);
+	if (!tiles.in_bounds(lvl_x, lvl_y)) {
+		return Tile();
+	}
+	return tiles.at(lvl_x, lvl_y);
+}
+void Simulation::activate_checkpoint(Scalar x, Scalar y) {
+	const int lvl_x = int(x - offset.x);
+	const int lvl_y = int(y - offset.y);
+	if (!tiles.in_bounds(lvl_x, lvl_y)) {
+		return;
+	}
+	active_checkpoint = { float(lvl_x), float(lvl_y) };
+	player_spawn = { float(lvl_x), lvl_y + 1.f };
+}
+void Simulation::respawn_player() {
+	player.spawn(to_vec2(get_player_spawn()));
+}
+void Simulation::complete() {
+	completed = true;
+}
@@ -34,10 +34,16 @@ void SingleRun::next_level() {
 	const int curr = level->get_level_nr();
 	total_stats += level->get_stats();
 
-	level = Levels::make_level(curr + 1, true);
-	if (level == nullptr) {
+	if (size_t(curr) + 1 == Levels::levels.size()) {
 		state = State::Won;
+		level = nullptr;
+		return;
 	}
+
+	level = Levels::make_level(curr + 1, true);
+	// a level that can't be loaded ends the run, rather than counting the
+	// levels played so far as a completed challenge
+	if (level == nullptr) main_menu();
 }
 void SingleRun::main_menu() {
 	if (sent_to_main_menu) return;
@@ -50,10 +56,9 @@ void SingleRun::reset_level() {
 		return;
 	}
 
-	const int curr = level->get_level_nr();
 	total_stats += level->get_stats();
 
-	level = Levels::make_level(curr, true);
+	level->reset();
 }
 
 void SingleRun::update(float dt) {
@@ -64,7 +69,7 @@ void SingleRun::update(float dt) {
 			initialised_winscreen = true;
 
 			PBFile pbs_file = PBFile::load();
-			const std::string key = "challenge_run";
+			const std::string key = pb_key("challenge_run");
 			auto pb = pbs_file.get(key);
 
 			const bool new_pb = pb == nullptr || total_stats.better_than(*pb);
@@ -75,12 +80,9 @@ void SingleRun::update(float dt) {
 			const std::string stats_label = "Time / Jumps / Deaths & Resets: ";
 			std::string stats_value;
 
-			const unsigned seconds = total_stats.time / global::PHYSICS_FPS;
-			const unsigned frames = total_stats.time % global::PHYSICS_FPS;
-			stats_value += std::to_string(seconds);
-			stats_value += ";";
-			if (frames < 10) stats_value += "0";
-			stats_value += std::to_string(frames);
+			char time_str[32];
+			format_time(time_str, sizeof(time_str), total_stats.time);
+			stats_value += time_str;
 
 			stats_value += " / ";
 
@@ -101,12 +103,9 @@ void SingleRun::update(float dt) {
 			if (pb == nullptr) {
 				pb_value = "N/A";
 			} else {
-				const unsigned seconds = pb->time / global::PHYSICS_FPS;
-				const unsigned frames = pb->time % global::PHYSICS_FPS;
-				pb_value += std::to_string(seconds);
-				pb_value += ";";
-				if (frames < 10) pb_value += "0";
-				pb_value += std::to_string(frames);
+				char time_str[32];
+				format_time(time_str, sizeof(time_str), pb->time);
+				pb_value += time_str;
 
 				pb_value += " / ";
 
@@ -1,10 +1,22 @@
 #include "stats.hpp"
 #include "globals.hpp"
 
+#include <cstdint>
+#include <cstdio>
 #include <filesystem>
 #include <fstream>
 #include <iostream>
 
+int format_time(char *buf, size_t size, unsigned ticks) {
+	const uint64_t hundredths = uint64_t(ticks) * 100 / global::PHYSICS_FPS;
+	return std::snprintf(buf, size, "%u.%02u", unsigned(hundredths / 100), unsigned(hundredths % 100));
+}
+
+std::string pb_key(const std::string &name) {
+	if (global::PHYSICS_FPS == global::DEFAULT_PHYSICS_FPS) return name;
+	return name + "@" + std::to_string(global::PHYSICS_FPS) + "hz";
+}
+
 static void trim(std::string &str) {
 	auto frst = str.find_first_not_of(" \r\t");
 	auto last = str.find_last_not_of(" \r\t");
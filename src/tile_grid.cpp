@@ -0,0 +1,84 @@
+#include "tile_grid.hpp"
+
+#include <iostream>
+#include <memory>
+#include <utility>
+
+const TileGrid::Chunk TileGrid::empty_chunk = {};
+
+TileGrid::TileGrid() : TileGrid({ Tile() }, 0, 0) { }
+
+TileGrid::TileGrid(std::vector<Tile> palette, int w, int h)
+: TileGrid(std::move(palette), w, h, nullptr)
+{ }
+
+TileGrid::TileGrid(std::vector<Tile> palette, int w, int h,
+		   std::shared_ptr<const void> backing)
+: palette(std::move(palette)), chunks{}, owned_chunks{},
+  backing(std::move(backing)), w(w), h(h),
+  chunks_w((w + CHUNK_MASK) >> CHUNK_BITS),
+  chunks_h((h + CHUNK_MASK) >> CHUNK_BITS)
+{
+	chunks.assign(size_t(chunks_w)*size_t(chunks_h), &empty_chunk);
+	owned_chunks.resize(chunks.size());
+}
+
+TileGrid::TileGrid(const Tile *tiles, int w, int h)
+: TileGrid({ Tile() }, w, h)
+{
+	bool warned = false;
+	for (int y = 0; y < h; ++y) {
+		for (int x = 0; x < w; ++x) {
+			const Tile &tile = tiles[size_t(x) + size_t(y)*w];
+
+			// palettes are tiny, so a linear search is plenty fast
+			size_t ix = 0;
+			while (ix < palette.size() && palette[ix] != tile) ++ix;
+
+			if (ix == palette.size() && palette.size() == MAX_PALETTE) {
+				if (!warned) {
+					std::cerr << "WARN: more than " << MAX_PALETTE << " distinct tiles in level, replacing extra tiles with air" << std::endl;
+					warned = true;
+				}
+				ix = 0;
+			} else if (ix == palette.size()) {
+				palette.push_back(tile);
+			}
+
+			set(x, y, index_t(ix));
+		}
+	}
+}
+
+void TileGrid::set(int x, int y, index_t ix) {
+	const size_t chunk = chunk_ix(x >> CHUNK_BITS, y >> CHUNK_BITS);
+
+	if (!owned_chunks[chunk]) {
+		// writing air into an empty chunk changes nothing, so don't
+		// allocate it
+		if (ix == 0 && chunks[chunk] == &empty_chunk) return;
+
+		owned_chunks[chunk] = std::make_unique<Chunk>(*chunks[chunk]);
+		chunks[chunk] = owned_chunks[chunk].get();
+	}
+
+	owned_chunks[chunk]->cells[((y & CHUNK_MASK) << CHUNK_BITS) | (x & CHUNK_MASK)] = ix;
+}
+
+void TileGrid::set_chunk(int cx, int cy, const Chunk *chunk) {
+	const size_t ix = chunk_ix(cx, cy);
+
+	owned_chunks[ix] = nullptr;
+	chunks[ix] = chunk;
+}
+
+size_t TileGrid::memory_usage() const {
+	size_t res = sizeof(*this)
+		+ palette.capacity() * sizeof(Tile)
+		+ chunks.capacity() * sizeof(const Chunk *)
+		+ owned_chunks.capacity() * sizeof(std::unique_ptr<Chunk>);
+	for (const auto &chunk : owned_chunks) {
+		if (chunk) res += sizeof(Chunk);
+	}
+	return res;
+}
@@ -1,17 +1,28 @@
 #include "util.hpp"
 
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+#include "fixed.hpp"
+
+#if defined(__SSE2__) || defined(__AVX__)
+#include <immintrin.h>
+#endif
+
 namespace util {
 
-Collision collide(Rectangle from, Rectangle to) {
-	Collision res = {};
+template<typename T>
+BasicCollision<T> collide(BasicRectangle<T> from, BasicRectangle<T> to) {
+	BasicCollision<T> res = {};
 
 	res.new_pos = { from.x, from.y };
 
-	const Vector2 from_centre = {
+	const BasicVector2<T> from_centre = {
 		from.x + from.width/2,
 		from.y + from.height/2,
 	};
-	const Vector2 to_centre = {
+	const BasicVector2<T> to_centre = {
 		to.x + to.width/2,
 		to.y + to.height/2,
 	};
@@ -19,25 +30,28 @@ Collision collide(Rectangle from, Rectangle to) {
 	const bool might_collide_horisontal =
 		(from.y <= to.y && from.y + from.height >= to.y)
 		|| (from.y <= to.y + to.height && from.y + from.height >= to.y + to.height)
-		|| (from.y <= to.y + to.height && from.y + from.height <= to.y);
+		|| (from.y <= to.y + to.height && from.y + from.height <= to.y)
+		// `to` may also be taller than `from` (eg. a merged collider)
+		|| (from.y >= to.y && from.y + from.height <= to.y + to.height);
 	;
 	const bool might_collide_vertical =
 		(from.x <= to.x && from.x + from.width >= to.x)
 		|| (from.x <= to.x + to.width && from.x + from.width >= to.x + to.width)
-		|| (from.x <= to.x + to.width && from.x + from.width <= to.x);
+		|| (from.x <= to.x + to.width && from.x + from.width <= to.x)
+		|| (from.x >= to.x && from.x + from.width <= to.x + to.width);
 	;
 
 	if (might_collide_horisontal) {
 		if (from_centre.x < to_centre.x) {
-			const float from_near_edge = from.x + from.width;
-			/* const float from_far_edge = from.x; */
-			const float to_near_edge = to.x;
-			/* const float to_far_edge = to.x + to.width; */
+			const T from_near_edge = from.x + from.width;
+			/* const T from_far_edge = from.x; */
+			const T to_near_edge = to.x;
+			/* const T to_far_edge = to.x + to.width; */
 
 			// smallest (signed) x-distance from `from` to `to`
-			const float near_dist = to_near_edge - from_near_edge;
+			const T near_dist = to_near_edge - from_near_edge;
 			// greatest (signed) x-distance from `from` to `to`
-			/* const float far_dist = to_far_edge - from_far_edge; */
+			/* const T far_dist = to_far_edge - from_far_edge; */
 
 			// right edge of `from` is touching or past left edge of `to`
 			if (near_dist <= 0) {
@@ -47,11 +61,11 @@ Collision collide(Rectangle from, Rectangle to) {
 				res.new_pos.x = to.x - from.width;
 			}
 		} else {
-			const float from_near_edge = from.x;
-			const float to_near_edge = to.x + to.width;
+			const T from_near_edge = from.x;
+			const T to_near_edge = to.x + to.width;
 
 			// smallest (signed) x-distance from `from` to `to`
-			const float near_dist = to_near_edge - from_near_edge;
+			const T near_dist = to_near_edge - from_near_edge;
 
 			// left edge of `from` is touching or past right edge of `to`
 			if (near_dist >= 0) {
@@ -66,10 +80,10 @@ Collision collide(Rectangle from, Rectangle to) {
 	// y is implemented as a copy of x
 	if (might_collide_vertical) {
 		if (from_centre.y < to_centre.y) {
-			const float from_near_edge = from.y + from.height;
-			const float to_near_edge = to.y;
+			const T from_near_edge = from.y + from.height;
+			const T to_near_edge = to.y;
 
-			const float near_dist = to_near_edge - from_near_edge;
+			const T near_dist = to_near_edge - from_near_edge;
 
 			if (near_dist <= 0) {
 				res.y_touches = true;
@@ -78,10 +92,10 @@ Collision collide(Rectangle from, Rectangle to) {
 				res.new_pos.y = to.y - from.height;
 			}
 		} else {
-			const float from_near_edge = from.y;
-			const float to_near_edge = to.y + to.height;
+			const T from_near_edge = from.y;
+			const T to_near_edge = to.y + to.height;
 
-			const float near_dist = to_near_edge - from_near_edge;
+			const T near_dist = to_near_edge - from_near_edge;
 
 			if (near_dist >= 0) {
 				res.y_touches = true;
@@ -94,5 +108,157 @@ Collision collide(Rectangle from, Rectangle to) {
 
 	return res;
 }
+template BasicCollision<float> collide(BasicRectangle<float> from, BasicRectangle<float> to);
+template BasicCollision<Fixed> collide(BasicRectangle<Fixed> from, BasicRectangle<Fixed> to);
+
+/*
+ * batched collision
+ *
+ * The SIMD version below does exactly what collide does, only on a vector of
+ * rectangles at once: both sides of every branch are computed, and the right
+ * one is selected with the comparison masks. Only the same basic operations
+ * (+, -, halving, and comparisons) are performed on the same values in the
+ * same order, so the results are bit for bit identical to collide's.
+ *
+ * It is written once, against a small set of helpers overloaded for the SSE
+ * and AVX vector types; AVX is only used if the compiler targets it (eg. with
+ * -mavx or -march=native), while SSE2 is always available on x86-64.
+ */
+
+#ifdef __SSE2__
+static __m128 load(const float *p, __m128) { return _mm_loadu_ps(p); }
+static void store(float *p, __m128 v) { _mm_storeu_ps(p, v); }
+// bit i is set if lane i of the mask is
+static int bits(__m128 mask) { return _mm_movemask_ps(mask); }
+static __m128 splat(float f, __m128) { return _mm_set1_ps(f); }
+static __m128 add(__m128 a, __m128 b) { return _mm_add_ps(a, b); }
+static __m128 sub(__m128 a, __m128 b) { return _mm_sub_ps(a, b); }
+static __m128 mul(__m128 a, __m128 b) { return _mm_mul_ps(a, b); }
+static __m128 le(__m128 a, __m128 b) { return _mm_cmple_ps(a, b); }
+static __m128 ge(__m128 a, __m128 b) { return _mm_cmpge_ps(a, b); }
+static __m128 lt(__m128 a, __m128 b) { return _mm_cmplt_ps(a, b); }
+static __m128 both(__m128 a, __m128 b) { return _mm_and_ps(a, b); }
+static __m128 either(__m128 a, __m128 b) { return _mm_or_ps(a, b); }
+// mask ? a : b, for masks of all ones or all zeroes
+static __m128 select(__m128 mask, __m128 a, __m128 b) {
+	return _mm_or_ps(_mm_and_ps(mask, a), _mm_andnot_ps(mask, b));
+}
+#endif
+
+#ifdef __AVX__
+static __m256 load(const float *p, __m256) { return _mm256_loadu_ps(p); }
+static void store(float *p, __m256 v) { _mm256_storeu_ps(p, v); }
+static int bits(__m256 mask) { return _mm256_movemask_ps(mask); }
+static __m256 splat(float f, __m256) { return _mm256_set1_ps(f); }
+static __m256 add(__m256 a, __m256 b) { return _mm256_add_ps(a, b); }
+static __m256 sub(__m256 a, __m256 b) { return _mm256_sub_ps(a, b); }
+static __m256 mul(__m256 a, __m256 b) { return _mm256_mul_ps(a, b); }
+static __m256 le(__m256 a, __m256 b) { return _mm256_cmp_ps(a, b, _CMP_LE_OQ); }
+static __m256 ge(__m256 a, __m256 b) { return _mm256_cmp_ps(a, b, _CMP_GE_OQ); }
+static __m256 lt(__m256 a, __m256 b) { return _mm256_cmp_ps(a, b, _CMP_LT_OQ); }
+static __m256 both(__m256 a, __m256 b) { return _mm256_and_ps(a, b); }
+static __m256 either(__m256 a, __m256 b) { return _mm256_or_ps(a, b); }
+static __m256 select(__m256 mask, __m256 a, __m256 b) {
+	return _mm256_blendv_ps(b, a, mask);
+}
+#endif
+
+#if defined(__SSE2__) || defined(__AVX__)
+// collides `from` with the sizeof(V)/sizeof(float) rectangles starting at
+// index i of `to`
+template<typename V>
+static void collide_lanes(Rectangle from, const RectangleBatch &to, size_t i, Collision *out) {
+	constexpr size_t LANES = sizeof(V)/sizeof(float);
+	const V any{};
+
+	const V from_x = splat(from.x, any), from_y = splat(from.y, any);
+	const V from_w = splat(from.width, any), from_h = splat(from.height, any);
+	const V to_x = load(to.x + i, any), to_y = load(to.y + i, any);
+	const V to_w = load(to.width + i, any), to_h = load(to.height + i, any);
+	const V zero = splat(0, any);
+	// halving by multiplying with 0.5 is exact, same as dividing by 2
+	const V half = splat(0.5f, any);
+
+	const V from_right = add(from_x, from_w), from_bottom = add(from_y, from_h);
+	const V to_right = add(to_x, to_w), to_bottom = add(to_y, to_h);
+	const V from_centre_x = add(from_x, mul(from_w, half));
+	const V from_centre_y = add(from_y, mul(from_h, half));
+	const V to_centre_x = add(to_x, mul(to_w, half));
+	const V to_centre_y = add(to_y, mul(to_h, half));
+
+	const V might_collide_horisontal = either(
+		either(
+			both(le(from_y, to_y), ge(from_bottom, to_y)),
+			both(le(from_y, to_bottom), ge(from_bottom, to_bottom))
+		),
+		either(
+			both(le(from_y, to_bottom), le(from_bottom, to_y)),
+			both(ge(from_y, to_y), le(from_bottom, to_bottom))
+		)
+	);
+	const V might_collide_vertical = either(
+		either(
+			both(le(from_x, to_x), ge(from_right, to_x)),
+			both(le(from_x, to_right), ge(from_right, to_right))
+		),
+		either(
+			both(le(from_x, to_right), le(from_right, to_x)),
+			both(ge(from_x, to_x), le(from_right, to_right))
+		)
+	);
+
+	const V x_before = lt(from_centre_x, to_centre_x);
+	const V x_dist = select(x_before, sub(to_x, from_right), sub(to_right, from_x));
+	const V x_touches = both(might_collide_horisontal, select(x_before, le(x_dist, zero), ge(x_dist, zero)));
+	const V x_pos = select(x_before, sub(to_x, from_w), to_right);
+
+	const V y_before = lt(from_centre_y, to_centre_y);
+	const V y_dist = select(y_before, sub(to_y, from_bottom), sub(to_bottom, from_y));
+	const V y_touches = both(might_collide_vertical, select(y_before, le(y_dist, zero), ge(y_dist, zero)));
+	const V y_pos = select(y_before, sub(to_y, from_h), to_bottom);
+
+	float dist_x[LANES], dist_y[LANES], pos_x[LANES], pos_y[LANES];
+	store(dist_x, both(x_touches, x_dist));
+	store(dist_y, both(y_touches, y_dist));
+	store(pos_x, select(x_touches, x_pos, from_x));
+	store(pos_y, select(y_touches, y_pos, from_y));
+	const int touches_x = bits(x_touches), touches_y = bits(y_touches);
+
+	for (size_t j = 0; j < LANES; ++j) {
+		out[i + j].dist = { dist_x[j], dist_y[j] };
+		out[i + j].new_pos = { pos_x[j], pos_y[j] };
+		out[i + j].x_touches = touches_x >> j & 1;
+		out[i + j].y_touches = touches_y >> j & 1;
+	}
+}
+#endif
+
+void collide_batch(Rectangle from, const RectangleBatch &to, Collision *out) {
+	size_t i = 0;
+#if defined(__AVX__)
+	for (; i + 8 <= to.count; i += 8) collide_lanes<__m256>(from, to, i, out);
+#endif
+#if defined(__SSE2__)
+	for (; i + 4 <= to.count; i += 4) collide_lanes<__m128>(from, to, i, out);
+#endif
+	// whatever doesn't fill a whole vector (or everything, without SIMD)
+	for (; i < to.count; ++i) {
+		out[i] = collide(from, { to.x[i], to.y[i], to.width[i], to.height[i] });
+	}
+}
+
+uint32_t bits(float f) {
+	uint32_t res;
+	std::memcpy(&res, &f, sizeof(res));
+	return res;
+}
+
+// see https://en.wikipedia.org/wiki/Fowler%E2%80%93Noll%E2%80%93Vo_hash_function
+void Hash::add_bytes(const void *data, size_t len) {
+	const auto *bytes = static_cast<const unsigned char *>(data);
+	for (size_t i = 0; i < len; ++i) {
+		value = (value ^ bytes[i]) * 0x100000001b3ull;
+	}
+}
 
 }
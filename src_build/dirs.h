@@ -5,5 +5,6 @@
 #define SRC_BUILD_DIR "src_build/"
 #define SRC_DIR "src/"
 #define INCLUDE_DIR "include/"
+#define TOOLS_DIR "tools/"
 
 #endif /* DIRS_H_ */
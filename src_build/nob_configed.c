@@ -8,17 +8,31 @@
 
 bool build_raylib(void);
 bool build_game(void);
+bool cook_levels(void);
 bool run_game(void);
+bool run_bench(void);
+bool run_checks(void);
+bool run_check_allocs(void);
 
 int main(int argc, char **argv) {
 	if (!build_raylib()) return 1;
 	if (!build_game()) return 1;
+	if (!cook_levels()) return 1;
 
 	bool run = false;
+	bool bench = false;
+	bool check = false;
+	bool check_allocs = false;
 	for (int i = 0; i < argc; ++i) {
 		if (strcmp(argv[i], "run") == 0) run = true;
+		if (strcmp(argv[i], "bench") == 0) bench = true;
+		if (strcmp(argv[i], "check") == 0) check = true;
+		if (strcmp(argv[i], "check-allocs") == 0) check_allocs = true;
 	}
 
+	if (check && !run_checks()) return 1;
+	if (bench && !run_bench()) return 1;
+	if (check_allocs && !run_check_allocs()) return 1;
 	if (run && !run_game()) return 1;
 }
 
@@ -84,64 +98,153 @@ bool build_raylib(void) {
 
 /* BUILDING THE GAME EXECUTABLE */
 
-// final executable differs between windows cross-build and native build
+// final executables differ between windows cross-build and native build
 #ifdef WINDOWS
-const char outfile[] = BUILD_DIR"game.exe";
+#define EXE(name) BUILD_DIR name ".exe"
 #else
-const char outfile[] = BUILD_DIR"game";
+#define EXE(name) BUILD_DIR name
 #endif
+const char outfile[] = EXE("game");
+const char cook_outfile[] = EXE("cook");
+const char headless_outfile[] = EXE("headless");
+const char verify_outfile[] = EXE("verify");
+const char bench_outfile[] = EXE("bench");
+const char collider_diff_outfile[] = EXE("collider_diff");
+const char collide_check_outfile[] = EXE("collide_check");
+const char recorder_check_outfile[] = EXE("recorder_check");
+const char callback_check_outfile[] = EXE("callback_check");
+const char check_allocs_outfile[] = EXE("check_allocs");
 
 // list headers used in the project
 #define HPP(header) const char *const header ## _hpp = INCLUDE_DIR #header ".hpp"
 HPP(actions);
+HPP(alloc_counter);
+HPP(callback_list);
 HPP(config);
+HPP(cooked_level);
+HPP(fixed);
+HPP(fixed_step);
 HPP(game);
 HPP(gui);
 HPP(globals);
 HPP(input_manager);
 HPP(level);
+HPP(level_data);
 HPP(level_scene);
 HPP(level_select);
 HPP(levels_list);
 HPP(main_menu);
+HPP(mapped_file);
 HPP(player);
+HPP(flight_recorder);
+HPP(perf_hud);
+HPP(profiler);
+HPP(replay);
 HPP(scene);
+HPP(simulation);
 HPP(util);
 HPP(overlay);
 HPP(singlerun);
 HPP(stats);
+HPP(tile_grid);
+HPP(collider_mesh);
+HPP(chunk_renderer);
+// and the helpers shared by the tools, which live next to them
+const char *const tool_util_hpp = TOOLS_DIR "tool_util.hpp";
 
 // list the headers each .cpp file depends on
 #define HEADERS(of, ...) const char *const of ## _headers[] = { of ## _hpp, __VA_ARGS__ }
 #define HEADERS_NO_SELF(of, ...) const char *const of ## _headers[] = { __VA_ARGS__ }
 
-HEADERS_NO_SELF(main, actions_hpp, input_manager_hpp, game_hpp, globals_hpp);
-HEADERS(game, globals_hpp, main_menu_hpp, scene_hpp);
-HEADERS(player, actions_hpp, level_hpp, stats_hpp, util_hpp);
-HEADERS(input_manager);
-HEADERS(actions, input_manager_hpp);
+HEADERS_NO_SELF(main,
+	actions_hpp, callback_list_hpp, config_hpp, flight_recorder_hpp, game_hpp,
+	globals_hpp, input_manager_hpp, perf_hud_hpp,
+);
+HEADERS(game,
+	actions_hpp, callback_list_hpp, flight_recorder_hpp, globals_hpp,
+	main_menu_hpp, perf_hud_hpp, profiler_hpp, scene_hpp,
+);
+HEADERS(player,
+	actions_hpp, callback_list_hpp, fixed_hpp, flight_recorder_hpp, globals_hpp,
+	profiler_hpp, simulation_hpp, stats_hpp, util_hpp,
+);
+HEADERS(input_manager, profiler_hpp);
+HEADERS(actions, callback_list_hpp, input_manager_hpp);
 HEADERS(level,
-	actions_hpp, globals_hpp, levels_list_hpp, overlay_hpp, player_hpp,
-	stats_hpp,
+	actions_hpp, alloc_counter_hpp, callback_list_hpp, chunk_renderer_hpp,
+	collider_mesh_hpp, config_hpp, fixed_hpp, fixed_step_hpp,
+	flight_recorder_hpp, globals_hpp, level_data_hpp, levels_list_hpp,
+	overlay_hpp, player_hpp, profiler_hpp, replay_hpp, simulation_hpp,
+	stats_hpp, tile_grid_hpp, util_hpp,
+);
+HEADERS(replay,
+	fixed_hpp, globals_hpp, level_data_hpp, player_hpp, simulation_hpp, stats_hpp,
+	util_hpp,
+);
+HEADERS(simulation,
+	collider_mesh_hpp, fixed_hpp, globals_hpp, level_data_hpp, player_hpp,
+	profiler_hpp, stats_hpp, tile_grid_hpp, util_hpp,
 );
 HEADERS(main_menu,
-	globals_hpp, gui_hpp, level_scene_hpp, level_select_hpp, scene_hpp
+	globals_hpp, gui_hpp, level_scene_hpp, level_select_hpp, levels_list_hpp,
+	scene_hpp,
 );
-HEADERS(levels_list, level_hpp);
-HEADERS(gui, globals_hpp);
+HEADERS(levels_list, cooked_level_hpp, fixed_step_hpp, level_hpp);
+HEADERS(gui, flight_recorder_hpp, globals_hpp);
 HEADERS(level_select,
 	gui_hpp, level_scene_hpp, levels_list_hpp, main_menu_hpp, scene_hpp,
 	singlerun_hpp
 );
 HEADERS(config);
-HEADERS(util);
-HEADERS(level_scene, level_hpp, levels_list_hpp, main_menu_hpp, scene_hpp);
-HEADERS(overlay, globals_hpp, gui_hpp);
+HEADERS(util, fixed_hpp);
+HEADERS(level_scene,
+	fixed_step_hpp, level_hpp, levels_list_hpp, main_menu_hpp, scene_hpp,
+);
+HEADERS(overlay, flight_recorder_hpp, globals_hpp, gui_hpp, profiler_hpp);
 HEADERS(singlerun,
-	gui_hpp, level_hpp, levels_list_hpp, main_menu_hpp, player_hpp,
-	scene_hpp
+	fixed_step_hpp, gui_hpp, level_hpp, levels_list_hpp, main_menu_hpp,
+	player_hpp, scene_hpp
 );
 HEADERS(stats, globals_hpp);
+HEADERS(tile_grid);
+HEADERS(collider_mesh, tile_grid_hpp);
+HEADERS(chunk_renderer, tile_grid_hpp);
+HEADERS(cooked_level, level_data_hpp, mapped_file_hpp, tile_grid_hpp);
+HEADERS(mapped_file);
+HEADERS(globals, config_hpp);
+HEADERS(profiler);
+HEADERS(fixed_step);
+HEADERS(flight_recorder, alloc_counter_hpp, config_hpp, globals_hpp);
+HEADERS(alloc_counter);
+HEADERS(perf_hud, actions_hpp, callback_list_hpp, flight_recorder_hpp, globals_hpp);
+
+HEADERS_NO_SELF(cook,
+	cooked_level_hpp, fixed_step_hpp, level_hpp, levels_list_hpp, player_hpp,
+	tool_util_hpp,
+);
+HEADERS_NO_SELF(headless,
+	fixed_hpp, fixed_step_hpp, globals_hpp, levels_list_hpp, player_hpp,
+	simulation_hpp, stats_hpp, tool_util_hpp,
+);
+HEADERS_NO_SELF(bench,
+	alloc_counter_hpp, fixed_hpp, fixed_step_hpp, level_hpp, levels_list_hpp,
+	player_hpp, simulation_hpp, stats_hpp, tool_util_hpp, util_hpp,
+);
+HEADERS_NO_SELF(verify,
+	fixed_hpp, globals_hpp, levels_list_hpp, player_hpp, replay_hpp,
+	simulation_hpp, stats_hpp, tool_util_hpp,
+);
+HEADERS_NO_SELF(collide_check, util_hpp);
+HEADERS_NO_SELF(collider_diff,
+	collider_mesh_hpp, fixed_hpp, level_data_hpp, levels_list_hpp, player_hpp,
+	simulation_hpp, stats_hpp, tile_grid_hpp, tool_util_hpp,
+);
+HEADERS_NO_SELF(recorder_check, config_hpp, flight_recorder_hpp, globals_hpp);
+HEADERS_NO_SELF(callback_check, actions_hpp, alloc_counter_hpp, callback_list_hpp);
+HEADERS_NO_SELF(check_allocs,
+	actions_hpp, globals_hpp, level_hpp, levels_list_hpp, player_hpp,
+	simulation_hpp, tool_util_hpp,
+);
 
 // most files in the project exists in src/name.cpp, outputs to build/name.o,
 // and depends on the headers defined in name_headers
@@ -149,19 +252,26 @@ HEADERS(stats, globals_hpp);
 	{ SRC_DIR #name ".cpp", BUILD_DIR #name ".o", \
 	  name ## _headers, ARRAY_LEN(name ## _headers) }
 
-// list the files in the project
+// the tools' main functions live in tools/name.cpp instead
+#define TOOL_FILE(name) \
+	{ TOOLS_DIR #name ".cpp", BUILD_DIR #name ".o", \
+	  name ## _headers, ARRAY_LEN(name ## _headers) }
+
+// list the files in the project, which are shared between the game and the
+// tools
 struct Target {
 	const char *src;
 	const char *obj;
 	const char *const *headers;
 	size_t n_headers;
 } targets[] = {
-	STANDARD_FILE(main),
 	STANDARD_FILE(game),
 	STANDARD_FILE(player),
 	STANDARD_FILE(input_manager),
 	STANDARD_FILE(actions),
 	STANDARD_FILE(level),
+	STANDARD_FILE(simulation),
+	STANDARD_FILE(replay),
 	STANDARD_FILE(main_menu),
 	STANDARD_FILE(levels_list),
 	STANDARD_FILE(gui),
@@ -172,6 +282,35 @@ struct Target {
 	STANDARD_FILE(overlay),
 	STANDARD_FILE(singlerun),
 	STANDARD_FILE(stats),
+	STANDARD_FILE(tile_grid),
+	STANDARD_FILE(collider_mesh),
+	STANDARD_FILE(chunk_renderer),
+	STANDARD_FILE(cooked_level),
+	STANDARD_FILE(mapped_file),
+	STANDARD_FILE(globals),
+	STANDARD_FILE(profiler),
+	STANDARD_FILE(flight_recorder),
+	STANDARD_FILE(perf_hud),
+	STANDARD_FILE(fixed_step),
+	STANDARD_FILE(alloc_counter),
+};
+
+// list the executables, each consisting of its own main file linked together
+// with all the shared files above
+struct Executable {
+	const char *outfile;
+	struct Target main;
+} executables[] = {
+	{ outfile, STANDARD_FILE(main) },
+	{ cook_outfile, TOOL_FILE(cook) },
+	{ headless_outfile, TOOL_FILE(headless) },
+	{ verify_outfile, TOOL_FILE(verify) },
+	{ bench_outfile, TOOL_FILE(bench) },
+	{ collider_diff_outfile, TOOL_FILE(collider_diff) },
+	{ collide_check_outfile, TOOL_FILE(collide_check) },
+	{ recorder_check_outfile, TOOL_FILE(recorder_check) },
+	{ callback_check_outfile, TOOL_FILE(callback_check) },
+	{ check_allocs_outfile, TOOL_FILE(check_allocs) },
 };
 
 // check if a particular file needs rebuilding
@@ -193,6 +332,10 @@ const char *compiler = "x86_64-w64-mingw32-g++";
 const char *compiler = "g++";
 #endif
 
+// turns the value of a macro defined in the config into a string literal
+#define VALUE_STRING_(value) #value
+#define VALUE_STRING(value) VALUE_STRING_(value)
+
 // flags used for compiling a certain c++ source to a .o file
 const char *cpp_flags[] = {
 #ifdef RELEASE
@@ -206,20 +349,40 @@ const char *cpp_flags[] = {
 	"-g",
 	"-fsanitize=address",
 #endif
+#ifdef ENABLE_THREAD_SANITIZER
+	"-g",
+	"-fsanitize=thread",
+#endif
 #ifdef ENABLE_PROFILER
 	"-g",
 	"-p",
+#endif
+#ifdef FLOAT_PHYSICS
+	"-DFLOAT_PHYSICS",
+#endif
+#ifdef ENABLE_AVX
+	"-mavx",
+#endif
+#ifdef PHYSICS_TICK_RATE
+	"-DPHYSICS_TICK_RATE=" VALUE_STRING(PHYSICS_TICK_RATE),
 #endif
 	"-Wall", "-Wextra",
+	// level loading uses threads
+	"-pthread",
 	"-I./include", "-I./raylib/src",
 };
 // flags used for compiling all the .o files into the final executable
 const char *ld_flags[] = {
 	"-O2",
+	"-pthread",
 #ifdef ENABLE_MEMORY_SANITIZER
 	"-g",
 	"-fsanitize=address",
 #endif
+#ifdef ENABLE_THREAD_SANITIZER
+	"-g",
+	"-fsanitize=thread",
+#endif
 #ifdef ENABLE_PROFILER
 	"-g",
 	"-p",
@@ -253,47 +416,74 @@ void cmd_push(Cmd *cmd, const char **args, size_t args_len) {
 	}
 }
 
+// compile a single .o file, asynchronously
+bool build_object(Cmd *cmd, Procs *procs, const struct Target *target) {
+	cmd_append(cmd, compiler, "-c");
+	cmd_push(cmd, cpp_flags, ARRAY_LEN(cpp_flags));
+	cmd_append(cmd, "-o", target->obj);
+	cmd_append(cmd, target->src);
+
+	// and build asynchronously, by default the number of threads
+	// is the number of processors on the machine (which might be
+	// threads or might be cores, depending on OS, iirc)
+	// once again, this saves a *lot* of dev time
+	// (I think my laptop has four "processors", which would
+	// roughly speed up build times 4x)
+	return cmd_run(cmd, .async = procs);
+}
+
 bool build_game(void) {
 	Cmd cmd = {0};
 	Procs procs = {0};
 
-	// keep track of if the executable actually needs to be rebuilt; if
-	// config.h has changed then it does...
-	bool exe_needs_rebuild = needs_rebuild1(outfile, config_header);
+	// keep track of if the shared .o files were rebuilt; if so, all the
+	// executables need to be relinked
+	bool shared_rebuilt = false;
 
 	for (size_t i = 0; i < ARRAY_LEN(targets); ++i) {
 		// don't rebuild it if it doesn't need to be rebuilt
 		// (this saves a *lot* of dev time)
 		if (!target_needs_rebuild(&targets[i])) continue;
 
-		// ...and if any .o file was rebuilt, the executable also needs
-		// to be rebuilt
-		exe_needs_rebuild = true;
-
-		cmd_append(&cmd, compiler, "-c");
-		cmd_push(&cmd, cpp_flags, ARRAY_LEN(cpp_flags));
-		cmd_append(&cmd, "-o", targets[i].obj);
-		cmd_append(&cmd, targets[i].src);
-
-		// and build asynchronously, by default the number of threads
-		// is the number of processors on the machine (which might be
-		// threads or might be cores, depending on OS, iirc)
-		// once again, this saves a *lot* of dev time
-		// (I think my laptop has four "processors", which would
-		// roughly speed up build times 4x)
-		if (!cmd_run(&cmd, .async = &procs)) return false;
+		shared_rebuilt = true;
+		if (!build_object(&cmd, &procs, &targets[i])) return false;
+	}
+
+	// keep track of which executables actually need to be rebuilt; if
+	// config.h has changed then it does...
+	bool exe_needs_rebuild[ARRAY_LEN(executables)];
+	for (size_t i = 0; i < ARRAY_LEN(executables); ++i) {
+		const struct Executable *exe = &executables[i];
+
+		// ...and if any of its .o files were rebuilt, the executable
+		// also needs to be rebuilt
+		exe_needs_rebuild[i] = shared_rebuilt
+			|| needs_rebuild1(exe->outfile, config_header);
+
+		if (!target_needs_rebuild(&exe->main)) continue;
+
+		exe_needs_rebuild[i] = true;
+		if (!build_object(&cmd, &procs, &exe->main)) return false;
 	}
 
 	// wait for all .o files to build before linking them together
 	if (!procs_flush(&procs)) return false;
 
-	// if neither config.h has changed, nor any .o files were rebuilt, then
-	// we don't need to rebuild the executable
-	if (exe_needs_rebuild) {
+	for (size_t i = 0; i < ARRAY_LEN(executables); ++i) {
+		const struct Executable *exe = &executables[i];
+
+		// if neither config.h has changed, nor any .o files were
+		// rebuilt, then we don't need to rebuild the executable
+		if (!exe_needs_rebuild[i]) {
+			nob_log(INFO, "%s is up-to-date, not rebuilding!", exe->outfile);
+			continue;
+		}
+
 		cmd_append(&cmd, compiler);
-		cmd_append(&cmd, "-o", outfile);
-		for (size_t i = 0; i < ARRAY_LEN(targets); ++i) {
-			cmd_append(&cmd, targets[i].obj);
+		cmd_append(&cmd, "-o", exe->outfile);
+		cmd_append(&cmd, exe->main.obj);
+		for (size_t j = 0; j < ARRAY_LEN(targets); ++j) {
+			cmd_append(&cmd, targets[j].obj);
 		}
 		// note that (iirc) linker flags like "-lm" should go *after*
 		// all the objects, for some reason?
@@ -301,22 +491,41 @@ bool build_game(void) {
 
 		if (!cmd_run(&cmd)) return false;
 
-#if defined(RELEASE) && !defined(WINDOWS) && !defined(ENABLE_PROFILER) && !defined(ENABLE_MEMORY_SANITIZER)
+#if defined(RELEASE) && !defined(WINDOWS) && !defined(ENABLE_PROFILER) && !defined(ENABLE_MEMORY_SANITIZER) && !defined(ENABLE_THREAD_SANITIZER)
 		// and strip the exe on release builds, results in a smaller
 		// exe (and theoretically harder to reverse-engineer, but I
 		// don't really care about that, I plan on having this
 		// open-source anyways)
-		cmd_append(&cmd, "strip", outfile);
+		cmd_append(&cmd, "strip", exe->outfile);
 		if (!cmd_run(&cmd)) return false;
-#elif defined(RELEASE) && defined(WINDOWS) && !defined(ENABLE_PROFILER) && !defined(ENABLE_MEMORY_SANITIZER)
+#elif defined(RELEASE) && defined(WINDOWS) && !defined(ENABLE_PROFILER) && !defined(ENABLE_MEMORY_SANITIZER) && !defined(ENABLE_THREAD_SANITIZER)
 		// only strip debug symbols on Windows to hopefully not trigger
 		// Windows Defender?
-		cmd_append(&cmd, "x86_64-w64-mingw32-strip", "--strip-debug", outfile);
+		cmd_append(&cmd, "x86_64-w64-mingw32-strip", "--strip-debug", exe->outfile);
 		if (!cmd_run(&cmd)) return false;
 #endif
-	} else nob_log(INFO, "Game executable is up-to-date, not rebuilding!");
+	}
+
+	return true;
+}
+
+/* COOKING THE LEVELS */
+
+bool cook_levels(void) {
+#ifdef WINDOWS
+	// the cook tool is cross-compiled as well, so it can't run here; the
+	// game falls back to loading the level images directly
+	nob_log(WARNING, "Cross-building for windows, not cooking levels");
+	return true;
+#else
+	// the cook tool itself decides which levels are out-of-date
+	Cmd cmd = {0};
+
+	cmd_append(&cmd, cook_outfile);
+	if (!cmd_run(&cmd)) return false;
 
 	return true;
+#endif
 }
 
 /* RUNNING THE COMPILED GAME EXECUTABLE */
@@ -329,3 +538,78 @@ bool run_game(void) {
 
 	return true;
 }
+
+/* RUNNING THE BENCHMARKS */
+
+// the baseline the benchmark results are compared against
+const char bench_baseline[] = TOOLS_DIR "bench_baseline.tsv";
+
+bool run_bench(void) {
+#ifdef WINDOWS
+	nob_log(WARNING, "Cross-building for windows, can't run the benchmarks");
+	return true;
+#else
+#ifndef RELEASE
+	nob_log(WARNING, "Benchmarking a debug build, the results won't be comparable to the baseline");
+#endif
+	Cmd cmd = {0};
+
+	cmd_append(&cmd, bench_outfile, "--baseline", bench_baseline);
+	if (!cmd_run(&cmd)) return false;
+
+	return true;
+#endif
+}
+
+/* RUNNING THE CHECKS */
+
+// each check is a tool which exits with non-zero if the check fails
+bool run_checks(void) {
+#ifdef WINDOWS
+	nob_log(WARNING, "Cross-building for windows, can't run the checks");
+	return true;
+#else
+	Cmd cmd = {0};
+
+	// the batched collision must match the plain one bit for bit
+	cmd_append(&cmd, collide_check_outfile);
+	if (!cmd_run(&cmd)) return false;
+
+	// merged colliders must play exactly like the individual tiles
+	cmd_append(&cmd, collider_diff_outfile);
+	if (!cmd_run(&cmd)) return false;
+
+	// the actions' callbacks must keep their order and never allocate
+	cmd_append(&cmd, callback_check_outfile);
+	if (!cmd_run(&cmd)) return false;
+
+	// playing a level mustn't allocate
+	cmd_append(&cmd, check_allocs_outfile);
+	if (!cmd_run(&cmd)) return false;
+
+	// the flight recorder's writer thread must get every frame intact
+	// (build with ENABLE_THREAD_SANITIZER to check for data races too)
+	cmd_append(&cmd, recorder_check_outfile);
+	if (!cmd_run(&cmd)) return false;
+
+	return true;
+#endif
+}
+
+/* RUNNING THE ALLOCATION CHECK */
+
+// plays every level without a window, failing if a frame allocates; see
+// tools/check_allocs.cpp (the game's --check-allocs covers drawing as well)
+bool run_check_allocs(void) {
+#ifdef WINDOWS
+	nob_log(WARNING, "Cross-building for windows, can't run the allocation check");
+	return true;
+#else
+	Cmd cmd = {0};
+
+	cmd_append(&cmd, check_allocs_outfile);
+	if (!cmd_run(&cmd)) return false;
+
+	return true;
+#endif
+}
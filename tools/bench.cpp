@@ -0,0 +1,457 @@
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "raylib.h"
+
+#include "alloc_counter.hpp"
+#include "level.hpp"
+#include "levels_list.hpp"
+#include "fixed.hpp"
+#include "player.hpp"
+#include "simulation.hpp"
+#include "stats.hpp"
+#include "util.hpp"
+
+#include "tool_util.hpp"
+
+/*
+ * microbenchmarks for the physics, collision, and level loading hot paths
+ *
+ * Usage: bench [--filter substring] [--baseline file] [--save file]
+ * Prints one line per benchmark: its name, nanoseconds per operation,
+ * operations per second, and heap allocations per operation, separated by
+ * tabs. With --baseline, the change in time per operation relative to the
+ * baseline file (in the same format) is printed as well; with --save, the
+ * results are written to the given file, eg. to update the baseline, keeping
+ * the comment lines at the top of the file if it already exists.
+ *
+ * All inputs are generated from fixed seeds, so every run measures exactly
+ * the same work.
+ */
+
+namespace {
+
+// keeps the compiler from optimising away the benchmarked work
+volatile uint64_t sink;
+
+// xorshift64, see https://en.wikipedia.org/wiki/Xorshift
+struct Rng {
+	uint64_t state;
+
+	uint64_t next() {
+		state ^= state << 13;
+		state ^= state >> 7;
+		state ^= state << 17;
+		return state;
+	}
+	float uniform(float min, float max) {
+		return min + (max - min) * float(next() >> 40) / float(1 << 24);
+	}
+};
+
+struct Result {
+	std::string name;
+	double ns_per_op;
+	double allocs_per_op;
+};
+
+std::string filter;
+std::vector<Result> results;
+
+// runs op(n), which should perform n operations, in batches which take at
+// least a few milliseconds, and keeps the fastest of several batches
+template<typename Op>
+void bench(const std::string &name, Op op) {
+	if (name.find(filter) == std::string::npos) return;
+
+	using clock = std::chrono::steady_clock;
+	constexpr double MIN_BATCH_SECS = 0.02;
+	constexpr int REPETITIONS = 5;
+
+	uint64_t n = 1;
+	for (;;) {
+		const auto start = clock::now();
+		op(n);
+		const double secs = std::chrono::duration<double>(clock::now() - start).count();
+		if (secs >= MIN_BATCH_SECS || n >= (uint64_t(1) << 40)) break;
+		n *= secs > 0 ? std::clamp<uint64_t>(MIN_BATCH_SECS / secs * 1.2, 2, 16) : 16;
+	}
+
+	double best = 1e300;
+	uint64_t allocs = 0;
+	for (int i = 0; i < REPETITIONS; ++i) {
+		const uint64_t allocs_before = alloc_counter::count();
+		const auto start = clock::now();
+		op(n);
+		const double secs = std::chrono::duration<double>(clock::now() - start).count();
+		allocs = alloc_counter::count() - allocs_before;
+		best = std::min(best, secs);
+	}
+
+	results.push_back({ name, best * 1e9 / n, double(allocs) / n });
+}
+
+void bench_collide() {
+	Rng rng{ 1 };
+	std::vector<Rectangle> from, to;
+	for (int i = 0; i < 1024; ++i) {
+		from.push_back({ rng.uniform(-1, 1), rng.uniform(-2, 1), 1, 2 });
+		to.push_back({
+			float(int(rng.uniform(-2, 2))), float(int(rng.uniform(-3, 2))),
+			float(1 + rng.next() % 3), float(1 + rng.next() % 3),
+		});
+	}
+
+	// in the physics' number type, as the physics uses it
+	std::vector<Rect> from_scalar, to_scalar;
+	for (size_t i = 0; i < from.size(); ++i) {
+		from_scalar.push_back({
+			Scalar(from[i].x), Scalar(from[i].y),
+			Scalar(from[i].width), Scalar(from[i].height),
+		});
+		to_scalar.push_back({
+			Scalar(to[i].x), Scalar(to[i].y),
+			Scalar(to[i].width), Scalar(to[i].height),
+		});
+	}
+	bench("util.collide", [&](uint64_t n) {
+		uint64_t res = 0;
+		for (uint64_t i = 0; i < n; ++i) {
+			const auto collision = util::collide(from_scalar[i & 1023], to_scalar[i & 1023]);
+			res += collision.x_touches + collision.y_touches;
+		}
+		sink = res;
+	});
+
+	// one rectangle against a batch of them, one at a time and all at once;
+	// the batched version only exists for floats, so these use floats
+	// throughout
+	std::vector<float> xs, ys, widths, heights;
+	for (const auto &rect : to) {
+		xs.push_back(rect.x);
+		ys.push_back(rect.y);
+		widths.push_back(rect.width);
+		heights.push_back(rect.height);
+	}
+	for (const size_t batch : { 4, 16 }) {
+		const std::string suffix = "/batch_" + std::to_string(batch);
+		bench("util.collide" + suffix, [&](uint64_t n) {
+			util::Collision collisions[16];
+			uint64_t res = 0;
+			for (uint64_t i = 0; i < n; ++i) {
+				const size_t start = (i * batch) & 1023;
+				for (size_t j = 0; j < batch; ++j) {
+					collisions[j] = util::collide(from[i & 1023], to[start + j]);
+				}
+				res += collisions[i % batch].x_touches;
+			}
+			sink = res;
+		});
+		bench("util.collide_batch" + suffix, [&](uint64_t n) {
+			util::Collision collisions[16];
+			uint64_t res = 0;
+			for (uint64_t i = 0; i < n; ++i) {
+				const size_t start = (i * batch) & 1023;
+				util::collide_batch(from[i & 1023], {
+					xs.data() + start, ys.data() + start,
+					widths.data() + start, heights.data() + start, batch,
+				}, collisions);
+				res += collisions[i % batch].x_touches;
+			}
+			sink = res;
+		});
+	}
+}
+
+// inputs like those of a (very bad) player, changing every few ticks
+std::vector<MotionInputs> random_inputs(uint64_t seed, size_t n) {
+	static constexpr MotionInputs choices[] = {
+		MotionInputs::None, MotionInputs::Jump, MotionInputs::DoubleJump,
+		MotionInputs::WalkLeft, MotionInputs::WalkRight, MotionInputs::Slam,
+	};
+	Rng rng{ seed };
+	std::vector<MotionInputs> res;
+	MotionInputs inputs = MotionInputs::None;
+	for (size_t i = 0; i < n; ++i) {
+		if (i % 8 == 0) {
+			const uint64_t r = rng.next();
+			inputs = MotionInputs(
+				uint8_t(choices[r % 6]) | uint8_t(choices[(r >> 8) % 6])
+			);
+		}
+		res.push_back(inputs);
+	}
+	return res;
+}
+
+void bench_level(size_t idx) {
+	const auto data = Levels::load_level_data(idx);
+	if (data == nullptr) return;
+	const std::string suffix = "/level_" + std::to_string(idx);
+
+	const auto inputs = random_inputs(idx + 1, 4096);
+
+	bench("simulation.tick" + suffix, [&](uint64_t n) {
+		Simulation sim(data);
+		const auto initial = sim.snapshot();
+		for (uint64_t i = 0; i < n; ++i) {
+			sim.tick(inputs[i & 4095]);
+			if (sim.is_completed()) sim.restore(initial);
+		}
+		sink = sim.get_stats().time;
+	});
+
+	// the cost of simulating a second at different tick rates (see
+	// PHYSICS_TICK_RATE), with the inputs changing at the same times as
+	// at 32 ticks per second
+	for (const int rate : { 32, 60, 120, 240 }) {
+		bench("simulation.second@" + std::to_string(rate) + "hz" + suffix, [&](uint64_t n) {
+			Simulation sim(data, rate);
+			const auto initial = sim.snapshot();
+			for (uint64_t second = 0; second < n; ++second) {
+				for (int i = 0; i < rate; ++i) {
+					sim.tick(inputs[(second*32 + i*32/rate) & 4095]);
+					if (sim.is_completed()) sim.restore(initial);
+				}
+			}
+			sink = sim.get_stats().time;
+		});
+	}
+
+	// the positions the player passes through
+	Simulation sim(data);
+	std::vector<Player::Snapshot> trajectory;
+	for (size_t i = 0; i < 4096; ++i) {
+		sim.tick(inputs[i]);
+		trajectory.push_back(sim.get_player().snapshot());
+	}
+	bench("player.on_ground" + suffix, [&](uint64_t n) {
+		Stats stats;
+		Player player(stats);
+		uint64_t res = 0;
+		for (uint64_t i = 0; i < n; ++i) {
+			player.restore(trajectory[i & 4095]);
+			res += player.on_ground(sim);
+		}
+		sink = res;
+	});
+
+	// points all over the level, in world coordinates
+	const Vector2 offset = sim.get_offset();
+	Rng rng{ idx + 1 };
+	std::vector<Vec2> points;
+	for (int i = 0; i < 4096; ++i) {
+		points.push_back(to_vec2({
+			offset.x + rng.uniform(0, data->tiles.width()),
+			offset.y + rng.uniform(0, data->tiles.height()),
+		}));
+	}
+	bench("simulation.get_tile" + suffix, [&](uint64_t n) {
+		uint64_t res = 0;
+		for (uint64_t i = 0; i < n; ++i) {
+			const auto &p = points[i & 4095];
+			res += uint64_t(sim.get_tile(p.x, p.y).type);
+		}
+		sink = res;
+	});
+	bench("simulation.get_collider" + suffix, [&](uint64_t n) {
+		uint64_t res = 0;
+		for (uint64_t i = 0; i < n; ++i) {
+			const auto &p = points[i & 4095];
+			res += int(sim.get_collider(p.x, p.y).width);
+		}
+		sink = res;
+	});
+	bench("simulation.get_colliders" + suffix, [&](uint64_t n) {
+		Simulation::Collider colliders[Simulation::MAX_COLLIDERS];
+		uint64_t res = 0;
+		for (uint64_t i = 0; i < n; ++i) {
+			const auto &p = points[i & 4095];
+			res += sim.get_colliders(
+				{ p.x - 1, p.y - Scalar(2.5f) }, { p.x + 1, p.y + Scalar(0.5f) },
+				colliders, Simulation::MAX_COLLIDERS
+			);
+		}
+		sink = res;
+	});
+}
+
+void bench_tilemap_of(const char *name, int w, int h) {
+	// mostly air, with horizontal platforms of random tiles
+	Rng rng{ uint64_t(w)*h };
+	const size_t colormap_len = sizeof(Levels::colormap)/sizeof(*Levels::colormap);
+	std::vector<Color> pixels(size_t(w)*h, Color { 255, 255, 255, 255 });
+	for (size_t i = 0; i < pixels.size() / 16; ++i) {
+		const size_t start = rng.next() % pixels.size();
+		const Color color = Levels::colormap[rng.next() % colormap_len].color;
+		const size_t len = 1 + rng.next() % 16;
+		for (size_t j = start; j < std::min(pixels.size(), start + len); ++j) {
+			pixels[j] = color;
+		}
+	}
+	const Image image = {
+		pixels.data(), w, h, 1, PIXELFORMAT_UNCOMPRESSED_R8G8B8A8,
+	};
+
+	bench(name, [&](uint64_t n) {
+		uint64_t res = 0;
+		for (uint64_t i = 0; i < n; ++i) {
+			res += Levels::tilemap_of(image).get_palette().size();
+		}
+		sink = res;
+	});
+}
+
+void bench_pbfile() {
+	Rng rng{ 42 };
+	PBFile pbs;
+	for (int i = 0; i < 32; ++i) {
+		pbs.set(std::to_string(i), {
+			unsigned(rng.next() % 10000), unsigned(rng.next() % 100),
+			unsigned(rng.next() % 100), int(rng.next() % 100),
+			int(rng.next() % 100),
+		});
+	}
+	std::ostringstream saved;
+	pbs.save(saved);
+	const std::string contents = saved.str();
+
+	bench("pbfile.save", [&](uint64_t n) {
+		uint64_t res = 0;
+		for (uint64_t i = 0; i < n; ++i) {
+			std::ostringstream out;
+			pbs.save(out);
+			res += out.tellp();
+		}
+		sink = res;
+	});
+	bench("pbfile.load", [&](uint64_t n) {
+		uint64_t res = 0;
+		for (uint64_t i = 0; i < n; ++i) {
+			std::istringstream in(contents);
+			res += PBFile::load(in).has_pb("0");
+		}
+		sink = res;
+	});
+}
+
+std::map<std::string, double> load_baseline(const std::string &path) {
+	std::map<std::string, double> res;
+	std::ifstream in(path);
+	if (!in) {
+		std::cerr << "WARN: could not open baseline " << path << std::endl;
+		return res;
+	}
+	std::string line;
+	while (std::getline(in, line)) {
+		if (line.empty() || line[0] == '#') continue;
+		std::istringstream fields(line);
+		std::string name;
+		double ns_per_op;
+		if (std::getline(fields, name, '\t') && fields >> ns_per_op) {
+			res[name] = ns_per_op;
+		}
+	}
+	return res;
+}
+
+// the comment lines at the top of a results file (say, where and how the
+// baseline was measured), other than the column names, so that saving over
+// the file keeps them
+std::vector<std::string> load_comments(const std::string &path) {
+	std::vector<std::string> res;
+	std::ifstream in(path);
+	std::string line;
+	while (std::getline(in, line) && !line.empty() && line[0] == '#') {
+		if (line.compare(0, 7, "# name\t") == 0) continue;
+		res.push_back(line);
+	}
+	return res;
+}
+
+// with a baseline, the change in time per operation is added as a column
+void write_results(std::ostream &out, const std::map<std::string, double> *baseline) {
+	out << "# name\tns/op\tops/s\tallocs/op" << (baseline ? "\tvs baseline\n" : "\n");
+	out << std::fixed;
+	for (const auto &result : results) {
+		out << result.name << '\t'
+			<< std::setprecision(2) << result.ns_per_op << '\t'
+			<< std::setprecision(0) << 1e9 / result.ns_per_op << '\t'
+			<< std::setprecision(2) << result.allocs_per_op;
+		if (baseline != nullptr) {
+			const auto found = baseline->find(result.name);
+			if (found == baseline->end()) {
+				out << "\tnew";
+			} else {
+				const double change = (result.ns_per_op / found->second - 1) * 100;
+				out << '\t' << std::showpos << std::setprecision(1) << change << '%' << std::noshowpos;
+			}
+		}
+		out << '\n';
+	}
+}
+
+}
+
+int main(int argc, char **argv) {
+	std::string baseline_path, save_path;
+	for (int i = 1; i < argc; i += 2) {
+		std::string *value;
+		if (std::strcmp(argv[i], "--filter") == 0) value = &filter;
+		else if (std::strcmp(argv[i], "--baseline") == 0) value = &baseline_path;
+		else if (std::strcmp(argv[i], "--save") == 0) value = &save_path;
+		else {
+			std::cerr << "ERROR: unknown option " << argv[i] << std::endl;
+			std::cerr << "Usage: " << argv[0] << " [--filter substring] [--baseline file] [--save file]" << std::endl;
+			return 1;
+		}
+		if (i + 1 == argc) {
+			std::cerr << "ERROR: option " << argv[i] << " needs a value" << std::endl;
+			return 1;
+		}
+		*value = argv[i + 1];
+	}
+
+	tool::quiet_raylib();
+
+	bench_collide();
+	for (size_t idx = 0; idx < Levels::levels.size(); ++idx) {
+		bench_level(idx);
+	}
+	bench_tilemap_of("levels.tilemap_of/64x32", 64, 32);
+	bench_tilemap_of("levels.tilemap_of/4096x4096", 4096, 4096);
+	bench_pbfile();
+
+	if (baseline_path.empty()) {
+		write_results(std::cout, nullptr);
+	} else {
+		const auto baseline = load_baseline(baseline_path);
+		write_results(std::cout, &baseline);
+	}
+
+	if (!save_path.empty()) {
+		auto comments = load_comments(save_path);
+		if (comments.empty()) {
+			comments.push_back("# regenerate with: bench --save " + save_path);
+		}
+		std::ofstream out(save_path);
+		for (const auto &comment : comments) out << comment << '\n';
+		write_results(out, nullptr);
+		if (!out) {
+			std::cerr << "ERROR: could not write " << save_path << std::endl;
+			return 1;
+		}
+	}
+	return 0;
+}
@@ -0,0 +1,139 @@
+#include <cstdint>
+#include <iostream>
+#include <string>
+#include <utility>
+
+#include "actions.hpp"
+#include "alloc_counter.hpp"
+#include "callback_list.hpp"
+
+/*
+ * checks the allocation-free callback storage the actions are built on:
+ * InlineFunction, CallbackList and CallbackHandle
+ *
+ * Usage: callback_check
+ * Callbacks must be called in the order they were added in (before and after
+ * others are removed), handles must remove their callback when destroyed,
+ * detached or moved over, detaching twice must not remove the callback that
+ * reused the slot, a full list must refuse new callbacks, and none of it may
+ * allocate. Exits with 1 if any check fails.
+ */
+
+namespace {
+
+int failures = 0;
+
+void expect(bool ok, const char *what) {
+	if (ok) return;
+	std::cout << "FAILED: " << what << std::endl;
+	++failures;
+}
+
+// the callbacks append their digit to the trace, so that it shows which were
+// called in what order
+std::string trace;
+
+void check_inline_function() {
+	InlineFunction<void()> empty;
+	expect(!empty, "a default InlineFunction is empty");
+
+	int calls = 0;
+	const int step = 3;
+	InlineFunction<int(int)> add([&calls, step](int x) { ++calls; return x + step; });
+	expect(bool(add), "an InlineFunction with a callable isn't empty");
+	const InlineFunction<int(int)> copy = add;
+	expect(add(1) == 4 && copy(2) == 5 && calls == 2, "InlineFunction and its copy call the callable with its captures");
+}
+
+void check_order_and_removal() {
+	using List = CallbackList<InlineFunction<void()>, 4>;
+	List list;
+	const auto run = [&list]() -> const std::string & {
+		trace.clear();
+		list.for_each([](const InlineFunction<void()> &cb) { cb(); });
+		return trace;
+	};
+
+	List::handle_t a = list.add([]() { trace += '1'; });
+	List::handle_t b = list.add([]() { trace += '2'; });
+	List::handle_t c = list.add([]() { trace += '3'; });
+	expect(run() == "123", "callbacks are called in the order they were added in");
+
+	b.detach();
+	expect(run() == "13" && list.size() == 2, "detaching removes only that callback and keeps the order");
+
+	// reuses the slot b had
+	List::handle_t d = list.add([]() { trace += '4'; });
+	expect(run() == "134", "a new callback goes after the others, even in a reused slot");
+	b.detach();
+	expect(run() == "134", "detaching twice doesn't remove the callback that reused the slot");
+
+	{
+		List::handle_t moved = std::move(a);
+		a.detach();
+		expect(run() == "134", "a moved-from handle doesn't remove anything");
+	}
+	expect(run() == "34", "a handle removes its callback when destroyed");
+
+	d = std::move(c);
+	expect(run() == "3", "moving over a handle removes the callback it had");
+
+	List::handle_t e = list.add([]() { trace += '5'; });
+	List::handle_t f = list.add([]() { trace += '6'; });
+	List::handle_t g = list.add([]() { trace += '7'; });
+	std::cout << "(an error about too many callbacks is expected next)" << std::endl;
+	List::handle_t h = list.add([]() { trace += '8'; });
+	expect(run() == "3567" && list.size() == 4, "a full list refuses new callbacks");
+	h.detach();
+	expect(run() == "3567", "the refused callback's handle removes nothing");
+}
+
+void check_actions() {
+	ActionOnce once;
+	auto a = once.register_cb([]() { trace += '1'; });
+	auto b = once.register_cb([]() { trace += '2'; });
+	trace.clear();
+	once.trigger();
+	expect(trace == "12", "ActionOnce calls its callbacks in order");
+
+	ActionStartStop start_stop;
+	auto c = start_stop.register_cb([]() { trace += 's'; }, []() { trace += 'e'; });
+	trace.clear();
+	start_stop.press();
+	start_stop.press();
+	start_stop.release();
+	expect(trace == "s" && start_stop.is_active(), "ActionStartStop only starts once for two keys held down");
+	start_stop.release();
+	start_stop.release();
+	expect(trace == "se" && !start_stop.is_active(), "ActionStartStop stops once both keys are released");
+
+	ActionSustain sustain;
+	float total = 0;
+	auto d = sustain.register_cb([&total](float dt) { total += dt; });
+	sustain.trigger(0.5f);
+	sustain.trigger(0.25f);
+	expect(total == 0.75f, "ActionSustain passes on the time step");
+}
+
+}
+
+int main(int argc, char **argv) {
+	if (argc > 1) {
+		std::cerr << "Usage: " << argv[0] << std::endl;
+		return 1;
+	}
+
+	// so that the trace never needs to grow while counting allocations
+	trace.reserve(64);
+
+	const uint64_t allocations_before = alloc_counter::count();
+	check_inline_function();
+	check_order_and_removal();
+	check_actions();
+	const uint64_t allocations = alloc_counter::count() - allocations_before;
+	expect(allocations == 0, "adding, calling and removing callbacks doesn't allocate");
+
+	std::cout << (failures == 0 ? "all callback checks passed" : "some callback checks FAILED")
+		<< " (" << allocations << " allocations)" << std::endl;
+	return failures == 0 ? 0 : 1;
+}
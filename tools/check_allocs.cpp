@@ -0,0 +1,119 @@
+#include <cstdint>
+#include <iostream>
+
+#include "raylib.h"
+
+#include "actions.hpp"
+#include "globals.hpp"
+#include "level.hpp"
+#include "levels_list.hpp"
+#include "simulation.hpp"
+
+#include "tool_util.hpp"
+
+/*
+ * allocation check: plays every level through the game's own Level class
+ * (rather than just its Simulation), without a window, and fails if any frame
+ * spent playing a level allocates
+ *
+ * Usage: check_allocs [frames] [seed]
+ * Each level is played for the given number of 60 FPS frames (20000 by
+ * default) with pseudo-random inputs determined by the seed, given through
+ * the same actions the keys trigger in the game. Completing the level or
+ * pressing restart resets it in place, as the game does, but the level is
+ * never paused and never gets to the win screen (which saves personal bests
+ * and replays). Exits with 1 if any frame allocated.
+ *
+ * Note that this checks the updates only: without a window nothing is drawn
+ * (or baked), so drawing is only checked by playing the game with
+ * --check-allocs. Either way only operator new is counted (see
+ * include/alloc_counter.hpp), not raylib's mallocs.
+ */
+
+// the actions held down, as pressing an action that is held already would
+// count as holding down a second key for it
+struct Held {
+	bool jump = false;
+	bool slam = false;
+	bool left = false;
+	bool right = false;
+
+	static void set(ActionStartStop &action, bool &held, bool down) {
+		if (down == held) return;
+		held = down;
+		if (down) action.press();
+		else action.release();
+	}
+	void set_all(bool jump, bool slam, bool left, bool right) {
+		set(Action::Jump, this->jump, jump);
+		set(Action::Slam, this->slam, slam);
+		set(Action::Left, this->left, left);
+		set(Action::Right, this->right, right);
+	}
+};
+
+static bool play(size_t idx, uint64_t frames, uint64_t seed) {
+	const auto data = Levels::load_level_data(idx);
+	if (data == nullptr) {
+		std::cerr << "ERROR: could not load level " << idx << std::endl;
+		return false;
+	}
+
+	Level level(idx, data, false);
+	const unsigned allocating_before = global::allocating_frames;
+	uint64_t rng = seed;
+	Held held;
+	uint64_t resets = 0;
+
+	for (uint64_t frame = 0; frame < frames; ++frame) {
+		// held inputs change every few frames, roughly like a (very bad)
+		// player, with the odd double jump, death, or restart
+		if (frame % 8 == 0) {
+			const uint64_t r = tool::next_random(rng);
+			held.set_all(r & 1, (r >> 1) % 8 == 0, (r >> 4) % 3 == 0, (r >> 6) % 3 == 1);
+			if ((r >> 8) % 4 == 0) Action::DoubleJump.trigger();
+			if ((r >> 10) % 256 == 0) Action::Suicide.trigger();
+			if ((r >> 18) % 256 == 0) Action::Reset.trigger();
+		}
+
+		level.update(1.f / global::FPS);
+
+		if (level.change == Level::Change::Reset || level.get_simulation().is_completed()) {
+			level.reset();
+			++resets;
+		}
+	}
+	held.set_all(false, false, false, false);
+
+	const unsigned allocating = global::allocating_frames - allocating_before;
+	std::cout << "level " << idx << ": " << frames << " frames (" << resets << " resets), "
+		<< allocating << " allocating" << std::endl;
+	return allocating == 0;
+}
+
+int main(int argc, char **argv) {
+	uint64_t frames = 20000;
+	uint64_t seed = 1;
+	if (argc > 3
+	    || (argc > 1 && !tool::parse_arg(argv[1], UINT32_MAX, frames))
+	    || (argc > 2 && !tool::parse_arg(argv[2], UINT64_MAX, seed))) {
+		std::cerr << "Usage: " << argv[0] << " [frames] [seed]" << std::endl;
+		std::cerr << "ERROR: frames must be between 1 and " << UINT32_MAX << ", and the seed a positive number" << std::endl;
+		return 1;
+	}
+
+	tool::quiet_raylib();
+
+	global::check_allocs = true;
+
+	bool all_ok = true;
+	for (size_t idx = 0; idx < Levels::levels.size(); ++idx) {
+		if (!play(idx, frames, seed)) all_ok = false;
+	}
+	if (global::allocating_frames != 0) {
+		std::cerr << "ERROR: " << global::allocating_frames << " frame(s) allocated while playing a level" << std::endl;
+	} else {
+		std::cerr << "INFO: no frames allocated while playing a level" << std::endl;
+	}
+	return all_ok ? 0 : 1;
+}
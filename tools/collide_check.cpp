@@ -0,0 +1,172 @@
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <iostream>
+#include <limits>
+#include <vector>
+
+#include "raylib.h"
+
+#include "util.hpp"
+
+/*
+ * checks that util::collide_batch gives bit for bit the same results as
+ * calling util::collide on each rectangle
+ *
+ * Usage: collide_check
+ * Every batch size from 0 to 40 is checked, starting at every offset into the
+ * rectangles from 0 to 7 (so the loads aren't aligned), which runs every full
+ * vector path compiled in (eight lanes with AVX, four with SSE) as well as the
+ * rectangles left over for the scalar path. The rectangles range from random
+ * floats to ones on a grid (like level colliders, where edges touch exactly)
+ * to degenerate ones (empty, infinite, NaN). Exits with 1 on any difference.
+ */
+
+namespace {
+
+// xorshift64, see https://en.wikipedia.org/wiki/Xorshift
+struct Rng {
+	uint64_t state;
+
+	uint64_t next() {
+		state ^= state << 13;
+		state ^= state >> 7;
+		state ^= state << 17;
+		return state;
+	}
+	float uniform(float min, float max) {
+		return min + (max - min) * float(next() >> 40) / float(1 << 24);
+	}
+	// on a grid of halves, so that edges often line up exactly
+	float grid(int min, int max) {
+		return min + float(next() % uint64_t(2*(max - min) + 1)) / 2;
+	}
+};
+
+// the rectangles, generated in one of a few ways
+enum class Kind { Random, Grid, Degenerate };
+
+float degenerate(Rng &rng) {
+	static constexpr float values[] = {
+		0, -0.f, 1, -1, 0.5f, 1e-30f, -1e-30f, 1e30f,
+		std::numeric_limits<float>::infinity(),
+		-std::numeric_limits<float>::infinity(),
+		std::numeric_limits<float>::quiet_NaN(),
+		std::numeric_limits<float>::denorm_min(),
+	};
+	return values[rng.next() % (sizeof(values)/sizeof(*values))];
+}
+
+Rectangle make_rect(Rng &rng, Kind kind) {
+	switch (kind) {
+		case Kind::Random: return {
+			rng.uniform(-4, 4), rng.uniform(-4, 4),
+			rng.uniform(0, 4), rng.uniform(0, 4),
+		};
+		case Kind::Grid: return {
+			rng.grid(-3, 3), rng.grid(-3, 3),
+			rng.grid(0, 3), rng.grid(0, 3),
+		};
+		case Kind::Degenerate: break;
+	}
+	return { degenerate(rng), degenerate(rng), degenerate(rng), degenerate(rng) };
+}
+
+uint32_t bits(float f) {
+	uint32_t res;
+	std::memcpy(&res, &f, sizeof(res));
+	return res;
+}
+
+bool same(const util::Collision &a, const util::Collision &b) {
+	return bits(a.dist.x) == bits(b.dist.x) && bits(a.dist.y) == bits(b.dist.y)
+		&& bits(a.new_pos.x) == bits(b.new_pos.x)
+		&& bits(a.new_pos.y) == bits(b.new_pos.y)
+		&& a.x_touches == b.x_touches && a.y_touches == b.y_touches;
+}
+
+std::ostream &operator<<(std::ostream &out, const Rectangle &r) {
+	return out << "{ " << r.x << ", " << r.y << ", " << r.width << ", " << r.height << " }";
+}
+std::ostream &operator<<(std::ostream &out, const util::Collision &c) {
+	return out << "dist " << c.dist.x << ", " << c.dist.y
+		<< "; new_pos " << c.new_pos.x << ", " << c.new_pos.y
+		<< "; touches " << c.x_touches << ", " << c.y_touches;
+}
+
+constexpr size_t MAX_BATCH = 40;
+constexpr size_t MAX_OFFSET = 7;
+
+// checks `rounds` random `from` rectangles against every batch size and offset
+// of a set of `to` rectangles; returns the number of differences
+size_t check(const char *name, Kind kind, uint64_t seed, int rounds) {
+	Rng rng{ seed };
+	size_t differences = 0;
+	uint64_t checked = 0;
+
+	for (int round = 0; round < rounds; ++round) {
+		const Rectangle from = make_rect(rng, kind);
+		std::vector<Rectangle> to;
+		std::vector<float> xs, ys, widths, heights;
+		for (size_t i = 0; i < MAX_BATCH + MAX_OFFSET; ++i) {
+			to.push_back(make_rect(rng, kind));
+			xs.push_back(to.back().x);
+			ys.push_back(to.back().y);
+			widths.push_back(to.back().width);
+			heights.push_back(to.back().height);
+		}
+
+		for (size_t offset = 0; offset <= MAX_OFFSET; ++offset) {
+			for (size_t count = 0; count <= MAX_BATCH; ++count) {
+				util::Collision batched[MAX_BATCH];
+				util::collide_batch(from, {
+					xs.data() + offset, ys.data() + offset,
+					widths.data() + offset, heights.data() + offset,
+					count,
+				}, batched);
+
+				for (size_t i = 0; i < count; ++i) {
+					++checked;
+					const auto expected = util::collide(from, to[offset + i]);
+					if (same(batched[i], expected)) continue;
+
+					// only the first few are worth reading
+					if (++differences <= 8) {
+						std::cout << name << ": " << from << " against "
+							<< to[offset + i] << " (rectangle " << i
+							<< " of " << count << "): batched "
+							<< batched[i] << ", expected " << expected
+							<< std::endl;
+					}
+				}
+			}
+		}
+	}
+
+	std::cout << name << ": " << checked << " collisions, " << differences << " different" << std::endl;
+	return differences;
+}
+
+}
+
+int main(int argc, char **argv) {
+	if (argc > 1) {
+		std::cerr << "Usage: " << argv[0] << std::endl;
+		return 1;
+	}
+
+	std::cout << "vector paths:"
+#ifdef __AVX__
+		<< " AVX (8 lanes)"
+#endif
+#ifdef __SSE2__
+		<< " SSE (4 lanes)"
+#endif
+		<< " scalar" << std::endl;
+
+	size_t differences = 0;
+	differences += check("random", Kind::Random, 1, 200);
+	differences += check("grid", Kind::Grid, 2, 200);
+	differences += check("degenerate", Kind::Degenerate, 3, 200);
+	return differences == 0 ? 0 : 1;
+}
@@ -0,0 +1,105 @@
+#include <cstdint>
+#include <iostream>
+#include <memory>
+#include <utility>
+
+#include "raylib.h"
+
+#include "collider_mesh.hpp"
+#include "level_data.hpp"
+#include "levels_list.hpp"
+#include "player.hpp"
+#include "simulation.hpp"
+#include "tile_grid.hpp"
+
+#include "tool_util.hpp"
+
+/*
+ * collider comparison: runs every level twice side by side with the same
+ * inputs, once with the merged colliders the game uses and once with one
+ * collider per tile (as before tiles were merged), and reports the first tick
+ * on which the two runs differ
+ *
+ * Usage: collider_diff [ticks] [seed]
+ * Each level is simulated for the given number of ticks (100000 by default)
+ * with pseudo-random inputs determined by the seed, as with the headless
+ * tool. Exits with 1 if any level's runs differ.
+ */
+
+// the same level, only with a collider for every tile
+static std::shared_ptr<const LevelData> per_tile(const LevelData &data) {
+	const TileGrid &src = data.tiles;
+	TileGrid tiles(src.get_palette(), src.width(), src.height());
+	for (int y = 0; y < src.height(); ++y) {
+		for (int x = 0; x < src.width(); ++x) {
+			const auto ix = src.index_at(x, y);
+			if (ix != 0) tiles.set(x, y, ix);
+		}
+	}
+
+	LevelData res(std::move(tiles), data.spawn, data.texts);
+	res.colliders = ColliderMesh(res.tiles, false);
+	return std::make_shared<const LevelData>(std::move(res));
+}
+
+static bool same_trajectory(size_t idx, uint64_t ticks, uint64_t seed) {
+	const auto merged_data = Levels::load_level_data(idx);
+	if (merged_data == nullptr) {
+		std::cerr << "ERROR: could not load level " << idx << std::endl;
+		return false;
+	}
+	const auto tiled_data = per_tile(*merged_data);
+
+	Simulation merged(merged_data);
+	Simulation tiled(tiled_data);
+	const auto merged_initial = merged.snapshot();
+	const auto tiled_initial = tiled.snapshot();
+	uint64_t rng = seed;
+	MotionInputs inputs = MotionInputs::None;
+
+	for (uint64_t tick = 0; tick < ticks; ++tick) {
+		if (tick % 8 == 0) inputs = tool::random_inputs(rng);
+		merged.tick(inputs);
+		tiled.tick(inputs);
+
+		if (merged.state_hash() != tiled.state_hash()) {
+			const Vector2 merged_pos = merged.get_player().get_pos(1);
+			const Vector2 tiled_pos = tiled.get_player().get_pos(1);
+			std::cout << "level " << idx << ": DIFFERS from tick " << tick
+				<< " (merged " << merged_pos.x << ", " << merged_pos.y
+				<< "; per tile " << tiled_pos.x << ", " << tiled_pos.y
+				<< ")" << std::endl;
+			return false;
+		}
+
+		if (merged.is_completed()) {
+			merged.restore(merged_initial);
+			tiled.restore(tiled_initial);
+		}
+	}
+
+	std::cout << "level " << idx << ": same for " << ticks << " ticks ("
+		<< merged_data->colliders.size() << " merged colliders, "
+		<< tiled_data->colliders.size() << " tiles)" << std::endl;
+	return true;
+}
+
+int main(int argc, char **argv) {
+	uint64_t ticks = 100000;
+	uint64_t seed = 1;
+	if (argc > 3
+	    || (argc > 1 && !tool::parse_arg(argv[1], UINT32_MAX, ticks))
+	    || (argc > 2 && !tool::parse_arg(argv[2], UINT64_MAX, seed))) {
+		std::cerr << "Usage: " << argv[0] << " [ticks] [seed]" << std::endl;
+		std::cerr << "ERROR: ticks must be between 1 and " << UINT32_MAX << ", and the seed a positive number" << std::endl;
+		return 1;
+	}
+
+	tool::quiet_raylib();
+
+	bool all_same = true;
+	for (size_t idx = 0; idx < Levels::levels.size(); ++idx) {
+		if (!same_trajectory(idx, ticks, seed)) all_same = false;
+	}
+	return all_same ? 0 : 1;
+}
@@ -0,0 +1,79 @@
+#include <cstring>
+#include <filesystem>
+#include <iostream>
+#include <string>
+#include <system_error>
+
+#include "raylib.h"
+
+#include "cooked_level.hpp"
+#include "level.hpp"
+#include "levels_list.hpp"
+
+#include "tool_util.hpp"
+
+/*
+ * offline level cooking: converts every level image in Levels::levels into the
+ * binary cooked level format, which the game can memory map directly
+ *
+ * Usage: cook [--force]
+ * Levels are only re-cooked if their image or the cook tool itself is newer
+ * than the cooked level, unless --force is given.
+ */
+
+static bool needs_cooking(const std::string &image, const std::string &cooked,
+			  const char *self) {
+	namespace fs = std::filesystem;
+	std::error_code ec;
+
+	const auto cooked_time = fs::last_write_time(cooked, ec);
+	if (ec) return true;
+
+	// if the cook tool has been rebuilt, the format or the level list
+	// might have changed
+	const auto self_time = fs::last_write_time(self, ec);
+	if (ec || self_time > cooked_time) return true;
+
+	const auto image_time = fs::last_write_time(image, ec);
+	return ec || image_time > cooked_time;
+}
+
+int main(int argc, char **argv) {
+	bool force = false;
+	for (int i = 1; i < argc; ++i) {
+		if (strcmp(argv[i], "--force") == 0) force = true;
+	}
+
+	tool::quiet_raylib();
+
+	int cooked = 0;
+	for (const auto &info : Levels::levels) {
+		const auto cooked_path = CookedLevel::path_for(info.filename);
+		if (!force && !needs_cooking(info.filename, cooked_path, argv[0])) {
+			continue;
+		}
+
+		Image image = LoadImage(info.filename.c_str());
+		if (image.data == nullptr) {
+			std::cerr << "ERROR: could not load level image " << info.filename << std::endl;
+			return 1;
+		}
+		if (!LevelData::check_size(info.filename, image.width, image.height)) {
+			UnloadImage(image);
+			return 1;
+		}
+		const LevelData level = {
+			Levels::tilemap_of(image), info.spawn, info.texts,
+		};
+		UnloadImage(image);
+
+		if (!CookedLevel::save(cooked_path, level)) {
+			return 1;
+		}
+		std::cerr << "INFO: cooked " << info.filename << " -> " << cooked_path << std::endl;
+		++cooked;
+	}
+
+	std::cerr << "INFO: cooked " << cooked << " level(s), " << Levels::levels.size() - cooked << " up-to-date" << std::endl;
+	return 0;
+}
@@ -0,0 +1,102 @@
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+#include <iostream>
+#include <memory>
+#include <string>
+
+#include "raylib.h"
+
+#include "fixed_step.hpp"
+#include "globals.hpp"
+#include "levels_list.hpp"
+#include "player.hpp"
+#include "simulation.hpp"
+#include "stats.hpp"
+
+#include "tool_util.hpp"
+
+/*
+ * headless simulation: runs the physics core of the levels as fast as
+ * possible, without a window, rendering, audio, or input handling
+ *
+ * Usage: headless [level|all] [ticks] [seed]
+ * Each level is simulated for the given number of ticks (100000 by default,
+ * and fewer than 2^32) with pseudo-random inputs, which are fully determined
+ * by the seed, so two runs with the same arguments should end in exactly the
+ * same state. Malformed or out of range arguments are rejected.
+ */
+
+static bool run(size_t idx, uint64_t ticks, uint64_t seed) {
+	const auto data = Levels::load_level_data(idx);
+	if (data == nullptr) {
+		std::cerr << "ERROR: could not load level " << idx << std::endl;
+		return false;
+	}
+
+	Simulation sim(data);
+	const auto initial = sim.snapshot();
+	// not bound to the clock or capped, so it runs at unlimited speed
+	FixedStepScheduler scheduler(global::PHYSICS_FPS);
+	Stats total_stats{};
+	uint64_t rng = seed;
+	MotionInputs inputs = MotionInputs::None;
+	unsigned completions = 0;
+
+	const auto start = std::chrono::steady_clock::now();
+	uint64_t tick = 0;
+	scheduler.run_ticks(ticks, [&]() {
+		if (tick++ % 8 == 0) inputs = tool::random_inputs(rng);
+		sim.tick(inputs);
+		if (sim.is_completed()) {
+			// keep going from the start, as the game would on a reset
+			++completions;
+			total_stats += sim.get_stats();
+			sim.restore(initial);
+		}
+		return true;
+	});
+	const auto end = std::chrono::steady_clock::now();
+	const double secs = std::chrono::duration<double>(end - start).count();
+
+	const Stats stats = total_stats + sim.get_stats();
+	const Vector2 pos = sim.get_player().get_pos(1);
+	std::cout << "level " << idx << ": " << ticks << " ticks in " << secs
+		<< "s (" << (secs > 0 ? ticks / secs : 0) << " ticks/s)\n"
+		<< "  jumps " << stats.total_jumps() << ", deaths " << stats.deaths
+		<< ", completions " << completions << ", final position "
+		<< pos.x << ", " << pos.y << std::endl;
+	return true;
+}
+
+int main(int argc, char **argv) {
+	const char *level = argc > 1 ? argv[1] : "all";
+	uint64_t ticks = 100000;
+	uint64_t seed = 1;
+	// the scheduler takes fewer than 2^32 ticks at a time
+	if (argc > 4
+	    || (argc > 2 && !tool::parse_arg(argv[2], UINT32_MAX, ticks))
+	    || (argc > 3 && !tool::parse_arg(argv[3], UINT64_MAX, seed))) {
+		std::cerr << "Usage: " << argv[0] << " [level|all] [ticks] [seed]" << std::endl;
+		std::cerr << "ERROR: ticks must be between 1 and " << UINT32_MAX << ", and the seed a positive number" << std::endl;
+		return 1;
+	}
+
+	tool::quiet_raylib();
+
+	if (std::strcmp(level, "all") != 0) {
+		// levels are numbered from 0 here, so level 0 has to be let
+		// through separately
+		uint64_t idx = 0;
+		if (std::strcmp(level, "0") != 0 && !tool::parse_arg(level, Levels::levels.size() - 1, idx)) {
+			std::cerr << "ERROR: the level must be \"all\" or between 0 and " << Levels::levels.size() - 1 << std::endl;
+			return 1;
+		}
+		return run(idx, ticks, seed) ? 0 : 1;
+	}
+
+	for (size_t idx = 0; idx < Levels::levels.size(); ++idx) {
+		if (!run(idx, ticks, seed)) return 1;
+	}
+	return 0;
+}
@@ -0,0 +1,152 @@
+#include <chrono>
+#include <cstdint>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <system_error>
+#include <thread>
+#include <vector>
+
+#include "config.hpp"
+#include "flight_recorder.hpp"
+#include "globals.hpp"
+
+/*
+ * checks the flight recorder's hand-off of frames to its writer thread, by
+ * recording frames as fast as possible with frequent hitches, so that the main
+ * thread keeps on copying frames for new dumps while the writer is still
+ * writing old ones
+ *
+ * Usage: recorder_check
+ * The dumps are written to a temporary folder rather than the data folder,
+ * and are then read back: there must be between one and the maximum number of
+ * them, each must end with a frame over the budget, no frame may be in two of
+ * them, and every frame's values must be the ones recorded. Exits with 1 if
+ * any of that doesn't hold. It is most useful in a build with
+ * ENABLE_THREAD_SANITIZER defined, which also reports any data race between
+ * the two threads.
+ */
+
+namespace {
+
+constexpr uint64_t FRAMES = 20000;
+constexpr int BUDGET_MS = 1;
+
+// hitches come in bursts, so that some come while the writer is still busy
+bool is_hitch(uint64_t frame) {
+	return frame % 1000 >= 990;
+}
+
+// the values recorded for each frame, which are checked in the dumps
+uint32_t ticks_of(uint64_t frame) { return frame % 7; }
+uint32_t rectangles_of(uint64_t frame) { return frame % 13; }
+
+void record_frames() {
+	FlightRecorder &recorder = FlightRecorder::get();
+	for (uint64_t frame = 0; frame < FRAMES; ++frame) {
+		recorder.begin_frame();
+		for (uint32_t i = 0; i < ticks_of(frame); ++i) recorder.count_physics_tick();
+		recorder.end_update();
+		recorder.count_rectangles(rectangles_of(frame));
+		recorder.begin_present();
+		if (is_hitch(frame)) std::this_thread::sleep_for(std::chrono::milliseconds(2*BUDGET_MS));
+		recorder.end_frame();
+	}
+	recorder.wait_for_dumps();
+}
+
+// checks one dump, adding its frames to seen; returns false if it's wrong
+bool check_dump(const std::filesystem::path &path, std::vector<bool> &seen) {
+	std::ifstream in(path);
+	std::string line;
+
+	// # frame <number> took <ms> ms, ...
+	uint64_t hitch;
+	float took;
+	std::string word;
+	std::getline(in, line);
+	std::istringstream header(line);
+	header >> word >> word >> hitch >> word >> took;
+	if (!header || hitch >= FRAMES || took <= BUDGET_MS) {
+		std::cout << path << ": bad header '" << line << "'" << std::endl;
+		return false;
+	}
+	std::getline(in, line); // column names
+
+	uint64_t count = 0;
+	uint64_t last = 0;
+	while (std::getline(in, line)) {
+		std::istringstream row(line);
+		uint64_t number;
+		float total, update, draw, present;
+		uint32_t ticks, draw_calls, rectangles;
+		row >> number >> total >> update >> draw >> present >> ticks >> draw_calls >> rectangles;
+		if (!row || number >= FRAMES) {
+			std::cout << path << ": bad row '" << line << "'" << std::endl;
+			return false;
+		}
+		if (count > 0 && number != last + 1) {
+			std::cout << path << ": frame " << number << " follows frame " << last << std::endl;
+			return false;
+		}
+		if (seen[number]) {
+			std::cout << path << ": frame " << number << " was already dumped" << std::endl;
+			return false;
+		}
+		if (ticks != ticks_of(number) || rectangles != rectangles_of(number) || draw_calls != rectangles) {
+			std::cout << path << ": frame " << number << " has the wrong values '" << line << "'" << std::endl;
+			return false;
+		}
+		seen[number] = true;
+		last = number;
+		++count;
+	}
+
+	if (count == 0 || count > FlightRecorder::CAPACITY || last != hitch) {
+		std::cout << path << ": " << count << " frames, ending at frame " << last
+			<< " rather than the hitch, frame " << hitch << std::endl;
+		return false;
+	}
+	return true;
+}
+
+}
+
+int main(int argc, char **argv) {
+	if (argc > 1) {
+		std::cerr << "Usage: " << argv[0] << std::endl;
+		return 1;
+	}
+
+	const std::filesystem::path dir = std::filesystem::temp_directory_path() / "platformer-recorder_check";
+	std::error_code err;
+	std::filesystem::remove_all(dir, err);
+	if (!std::filesystem::create_directory(dir, err)) {
+		std::cerr << "ERROR: could not create " << dir << ": " << err.message() << std::endl;
+		return 1;
+	}
+	// the recorder expects the folder to end with a separator
+	const std::string data_dir = (dir / "").string();
+	global::DATA_DIR = data_dir.c_str();
+	global::config.hitch_budget_ms = BUDGET_MS;
+
+	record_frames();
+
+	bool ok = true;
+	int dumps = 0;
+	std::vector<bool> seen(FRAMES);
+	for (const auto &entry : std::filesystem::directory_iterator(dir)) {
+		++dumps;
+		if (!check_dump(entry.path(), seen)) ok = false;
+	}
+	if (dumps == 0 || dumps > FlightRecorder::MAX_DUMPS) {
+		std::cout << dumps << " dumps written, expected 1 to " << FlightRecorder::MAX_DUMPS << std::endl;
+		ok = false;
+	}
+	std::cout << dumps << " dumps of " << FRAMES << " frames " << (ok ? "ok" : "WRONG") << std::endl;
+
+	std::filesystem::remove_all(dir, err);
+	return ok ? 0 : 1;
+}
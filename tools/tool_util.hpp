@@ -0,0 +1,58 @@
+#pragma once
+
+#include <cerrno>
+#include <cstdint>
+#include <cstdlib>
+
+#include "raylib.h"
+
+#include "player.hpp"
+
+/*
+ * helpers shared between the tools in this folder: seeded pseudo-random
+ * inputs, argument parsing, and quieting raylib
+ */
+
+namespace tool {
+
+// xorshift64, see https://en.wikipedia.org/wiki/Xorshift
+inline uint64_t next_random(uint64_t &state) {
+	state ^= state << 13;
+	state ^= state >> 7;
+	state ^= state << 17;
+	return state;
+}
+
+// held inputs for the next few ticks, roughly like a (very bad) player
+inline MotionInputs random_inputs(uint64_t &state) {
+	static constexpr MotionInputs choices[] = {
+		MotionInputs::None,
+		MotionInputs::Jump,
+		MotionInputs::DoubleJump,
+		MotionInputs::WalkLeft,
+		MotionInputs::WalkRight,
+		MotionInputs::Slam,
+	};
+	uint8_t res = 0;
+	const uint64_t r = next_random(state);
+	for (int i = 0; i < 2; ++i) {
+		res |= uint8_t(choices[(r >> (8*i)) % (sizeof(choices)/sizeof(*choices))]);
+	}
+	return MotionInputs(res);
+}
+
+// parses a whole decimal argument, which must be between 1 and max
+inline bool parse_arg(const char *arg, uint64_t max, uint64_t &out) {
+	if (*arg < '0' || *arg > '9') return false;
+	char *end;
+	errno = 0;
+	out = std::strtoull(arg, &end, 10);
+	return errno == 0 && *end == '\0' && out > 0 && out <= max;
+}
+
+// only errors are of interest to the tools, raylib is quite chatty otherwise
+inline void quiet_raylib() {
+	SetTraceLogLevel(LOG_WARNING);
+}
+
+}
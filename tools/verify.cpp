@@ -0,0 +1,267 @@
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <iostream>
+#include <memory>
+#include <optional>
+#include <string>
+#include <system_error>
+#include <thread>
+#include <vector>
+
+#include "raylib.h"
+
+#include "globals.hpp"
+#include "levels_list.hpp"
+#include "replay.hpp"
+#include "simulation.hpp"
+#include "stats.hpp"
+
+#include "tool_util.hpp"
+
+/*
+ * batch replay verification: re-simulates every replay in a directory and
+ * checks that it still ends with the stats it claims, eg. after a change to
+ * the physics
+ *
+ * Usage: verify [--rehash] [directory] [-j threads]
+ * The directory defaults to the game's replay directory, and the number of
+ * threads to the number of cores. Unknown options and malformed thread counts
+ * are rejected. Exits with 1 if any replay fails.
+ *
+ * Replays with state hashes are checked tick by tick, and the first tick on
+ * which the state differs from the recording is reported. With --rehash, the
+ * replays which verify OK are rewritten with the state hashes of this build,
+ * so that another build (eg. with other optimisation flags, or another
+ * compiler) can then be checked against this one; failing replays are left
+ * as they are, so that they can still be looked into.
+ *
+ * For replays which recorded the input latency of their presses, the mean
+ * and maximum latency are reported too.
+ */
+
+namespace {
+
+enum class Outcome {
+	Ok,
+	Mismatch, // completed, but with different stats
+	Incomplete, // the replay ended before the level was completed
+	Desync, // the state differed from the recorded state hashes
+	NoLevel,
+	Invalid,
+};
+
+struct Result {
+	std::string path;
+	Outcome outcome = Outcome::Invalid;
+	size_t level_nr = 0;
+	bool level_changed = false;
+	bool build_changed = false;
+	bool rehashed = false;
+	uint32_t desync_tick = 0;
+	Stats claimed{};
+	Stats actual{};
+	uint32_t ticks = 0;
+	// the input latencies recorded with the run, in milliseconds
+	size_t presses = 0;
+	float mean_latency = 0;
+	float max_latency = 0;
+};
+
+bool operator==(const Stats &a, const Stats &b) {
+	return a.time == b.time && a.jumps == b.jumps
+		&& a.double_jumps == b.double_jumps && a.deaths == b.deaths
+		&& a.restarts == b.restarts;
+}
+
+// rewrites the replay with the state hashes of this build
+bool rehash(const std::string &path, const Replay &replay, std::shared_ptr<const LevelData> data) {
+	Replay res(replay.level_nr, *data, true);
+	res.stats = replay.stats;
+
+	Simulation sim(data);
+	const auto &latencies = replay.get_latencies();
+	size_t next_latency = 0;
+	for (const auto &run : replay.get_runs()) {
+		for (uint32_t i = 0; i < run.length; ++i) {
+			for (; next_latency < latencies.size() && latencies[next_latency].tick == res.length(); ++next_latency) {
+				res.record_latency(latencies[next_latency].input, latencies[next_latency].micros);
+			}
+			res.record(run.inputs);
+			sim.tick(run.inputs);
+			res.record_hash(sim.state_hash());
+		}
+	}
+
+	return res.save(path);
+}
+
+void verify(Result &result, bool rehash_replay) {
+	const auto replay = Replay::load(result.path);
+	if (!replay.has_value()) {
+		result.outcome = Outcome::Invalid;
+		return;
+	}
+	result.level_nr = replay->level_nr;
+	result.claimed = replay->stats;
+	result.build_changed = replay->build_id != Replay::current_build_id();
+
+	uint64_t total_latency = 0;
+	uint32_t max_latency = 0;
+	for (const auto &latency : replay->get_latencies()) {
+		total_latency += latency.micros;
+		max_latency = std::max(max_latency, latency.micros);
+	}
+	result.presses = replay->get_latencies().size();
+	if (result.presses > 0) {
+		result.mean_latency = total_latency / 1000.0f / result.presses;
+		result.max_latency = max_latency / 1000.0f;
+	}
+
+	const auto data = Levels::load_level_data(replay->level_nr);
+	if (data == nullptr) {
+		result.outcome = Outcome::NoLevel;
+		return;
+	}
+	result.level_changed = replay->content_hash != data->content_hash;
+
+	ReplayPlayer player(*replay, data);
+	result.ticks = player.fast_forward(replay->length());
+
+	const auto &sim = player.get_simulation();
+	result.actual = sim.get_stats();
+	if (player.get_desync().has_value()) {
+		result.outcome = Outcome::Desync;
+		result.desync_tick = *player.get_desync();
+	} else if (!sim.is_completed()) {
+		result.outcome = Outcome::Incomplete;
+	} else if (result.actual == result.claimed) {
+		result.outcome = Outcome::Ok;
+	} else {
+		result.outcome = Outcome::Mismatch;
+	}
+
+	if (rehash_replay && result.outcome == Outcome::Ok) {
+		result.rehashed = rehash(result.path, *replay, data);
+	}
+}
+
+std::ostream &operator<<(std::ostream &out, const Stats &stats) {
+	return out << "time " << stats.time << ", jumps " << stats.jumps
+		<< "+" << stats.double_jumps << ", deaths " << stats.deaths;
+}
+
+}
+
+// far more than there are cores to run them on
+constexpr uint64_t MAX_THREADS = 1024;
+
+int main(int argc, char **argv) {
+	std::string dir = std::string(global::DATA_DIR) + global::REPLAYS_DIR;
+	bool has_dir = false;
+	uint64_t threads = std::max(std::thread::hardware_concurrency(), 1u);
+	bool rehash_replays = false;
+	const auto usage = [argv](const std::string &error) {
+		std::cerr << "Usage: " << argv[0] << " [--rehash] [directory] [-j threads]" << std::endl;
+		std::cerr << "ERROR: " << error << std::endl;
+		return 1;
+	};
+	for (int i = 1; i < argc; ++i) {
+		if (std::strcmp(argv[i], "--rehash") == 0) {
+			rehash_replays = true;
+		} else if (std::strcmp(argv[i], "-j") == 0) {
+			if (i + 1 == argc || !tool::parse_arg(argv[++i], MAX_THREADS, threads)) {
+				return usage("-j takes a number of threads between 1 and " + std::to_string(MAX_THREADS));
+			}
+		} else if (argv[i][0] == '-') {
+			return usage(std::string("unknown option ") + argv[i]);
+		} else if (has_dir) {
+			return usage(std::string("more than one directory given, ") + argv[i]);
+		} else {
+			dir = argv[i];
+			has_dir = true;
+		}
+	}
+
+	tool::quiet_raylib();
+
+	std::vector<Result> results;
+	std::error_code ec;
+	for (const auto &entry : std::filesystem::directory_iterator(dir, ec)) {
+		if (entry.path().extension() != ".rpl") continue;
+		results.push_back({});
+		results.back().path = entry.path().string();
+	}
+	if (ec) {
+		std::cerr << "ERROR: could not read directory " << dir << ": " << ec.message() << std::endl;
+		return 1;
+	}
+	std::sort(results.begin(), results.end(), [](const Result &a, const Result &b) {
+		return a.path < b.path;
+	});
+
+	// each worker takes the next unverified replay until there are none
+	// left, so that long replays don't hold up the others
+	const auto start = std::chrono::steady_clock::now();
+	std::atomic<size_t> next = 0;
+	std::vector<std::thread> workers;
+	threads = std::min<size_t>(threads, std::max<size_t>(results.size(), 1));
+	for (uint64_t t = 0; t < threads; ++t) {
+		workers.emplace_back([&]() {
+			for (size_t i = next++; i < results.size(); i = next++) {
+				verify(results[i], rehash_replays);
+			}
+		});
+	}
+	for (auto &worker : workers) worker.join();
+	const double secs = std::chrono::duration<double>(
+		std::chrono::steady_clock::now() - start
+	).count();
+
+	size_t failed = 0;
+	uint64_t total_ticks = 0;
+	for (const auto &result : results) {
+		total_ticks += result.ticks;
+		std::cout << result.path << ": ";
+		switch (result.outcome) {
+			case Outcome::Ok: {
+				std::cout << "OK (" << result.actual << ")";
+			} break;
+			case Outcome::Mismatch: {
+				std::cout << "MISMATCH (claimed " << result.claimed << "; got " << result.actual << ")";
+			} break;
+			case Outcome::Desync: {
+				std::cout << "DESYNC (first differs from the recording after tick " << result.desync_tick << "; claimed " << result.claimed << "; got " << result.actual << ")";
+			} break;
+			case Outcome::Incomplete: {
+				std::cout << "INCOMPLETE (level not completed after " << result.ticks << " ticks)";
+			} break;
+			case Outcome::NoLevel: {
+				std::cout << "NO LEVEL (level " << result.level_nr << " does not exist)";
+			} break;
+			case Outcome::Invalid: {
+				std::cout << "INVALID (not a valid replay)";
+			} break;
+		}
+		if (result.level_changed) std::cout << " [level changed since recording]";
+		if (result.build_changed) std::cout << " [recorded by a different build]";
+		if (result.rehashed) std::cout << " [rehashed]";
+		else if (rehash_replays) std::cout << " [not rehashed]";
+		if (result.presses > 0) {
+			std::cout << " [input latency " << result.mean_latency << " ms mean, "
+				<< result.max_latency << " ms max over " << result.presses << " presses]";
+		}
+		std::cout << '\n';
+
+		if (result.outcome != Outcome::Ok) ++failed;
+	}
+
+	std::cout << results.size() - failed << "/" << results.size()
+		<< " replay(s) verified, " << total_ticks << " ticks in " << secs
+		<< "s on " << threads << " thread(s)" << std::endl;
+	return failed == 0 ? 0 : 1;
+}